@@ -0,0 +1,213 @@
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "automaton.h"
+
+
+static int leek_automaton_grow(struct leek_automaton *automaton)
+{
+	uint32_t max = 2 * automaton->trie_max + 1024;
+	uint16_t *trie;
+	uint8_t *output;
+	int ret = -1;
+
+	if (max > LEEK_AUTOMATON_STATES_MAX)
+		max = LEEK_AUTOMATON_STATES_MAX;
+
+	trie = realloc(automaton->trie, max * LEEK_AUTOMATON_SYMBOLS * sizeof(*trie));
+	if (!trie)
+		goto error;
+	automaton->trie = trie;
+
+	output = realloc(automaton->trie_output, max * sizeof(*output));
+	if (!output)
+		goto error;
+	automaton->trie_output = output;
+
+	memset(&trie[automaton->trie_max * LEEK_AUTOMATON_SYMBOLS], 0,
+	       (max - automaton->trie_max) * LEEK_AUTOMATON_SYMBOLS * sizeof(*trie));
+	memset(&output[automaton->trie_max], 0, max - automaton->trie_max);
+	automaton->trie_max = max;
+
+	ret = 0;
+	goto out;
+
+error:
+	fprintf(stderr, "error: realloc: %s\n", strerror(errno));
+out:
+	return ret;
+}
+
+
+int leek_automaton_init(struct leek_automaton *automaton, unsigned int flags)
+{
+	int ret = -1;
+
+	automaton->grams = leek_region_alloc((1U << LEEK_AUTOMATON_GRAM_BITS) / 8);
+	if (!automaton->grams) {
+		fprintf(stderr, "error: malloc: %s\n", strerror(errno));
+		goto out;
+	}
+
+	ret = leek_automaton_grow(automaton);
+	if (ret < 0)
+		goto out;
+
+	automaton->state_count = 1;
+	automaton->flags = flags;
+	automaton->len_min = LEEK_ADDRESS_LEN;
+out:
+	return ret;
+}
+
+
+/* Words are first stored as a trie (missing transitions go to the root) */
+int leek_automaton_add(struct leek_automaton *automaton, const uint8_t *symbols,
+                       unsigned int length)
+{
+	unsigned int start = 0;
+	unsigned int state = 0;
+	uint32_t gram = 0;
+	int ret = -1;
+
+	/* Suffixes are prefiltered on their end */
+	if (!(automaton->flags & LEEK_AUTOMATON_ANYWHERE))
+		start = length - LEEK_AUTOMATON_GRAM;
+	for (unsigned int i = start; i < start + LEEK_AUTOMATON_GRAM; ++i)
+		gram = (gram << LEEK_RAWADDR_CHAR_BITS) | symbols[i];
+	automaton->grams[gram / 64] |= (1ULL << (gram % 64));
+
+	if (length < automaton->len_min)
+		automaton->len_min = length;
+
+	for (unsigned int i = 0; i < length; ++i) {
+		uint16_t *next = &automaton->trie[state * LEEK_AUTOMATON_SYMBOLS + symbols[i]];
+
+		if (!*next) {
+			if (automaton->state_count == LEEK_AUTOMATON_STATES_MAX) {
+				fprintf(stderr, "error: too many words for the automaton.\n");
+				goto out;
+			}
+			if (   automaton->state_count == automaton->trie_max
+			    && leek_automaton_grow(automaton) < 0)
+				goto out;
+
+			/* Storage may have moved */
+			next = &automaton->trie[state * LEEK_AUTOMATON_SYMBOLS + symbols[i]];
+			*next = automaton->state_count++;
+		}
+		state = *next;
+	}
+
+	/* Shorter words are found first in substring mode, keep the longest one */
+	if (length > automaton->trie_output[state])
+		automaton->trie_output[state] = length;
+
+	ret = 0;
+out:
+	return ret;
+}
+
+
+/* Breadth first walk: failure links point to a shallower state, which
+ * transitions are already complete when they are copied. */
+int leek_automaton_finalize(struct leek_automaton *automaton)
+{
+	uint32_t count = automaton->state_count;
+	uint32_t head = 0;
+	uint32_t tail = 0;
+	uint16_t *queue;
+	uint16_t *fail;
+	uint16_t *delta;
+	uint8_t *output;
+	int ret = -1;
+
+	queue = malloc(count * sizeof(*queue));
+	fail = calloc(count, sizeof(*fail));
+	delta = leek_region_alloc(count * LEEK_AUTOMATON_SYMBOLS * sizeof(*delta));
+	output = leek_region_alloc(count * sizeof(*output));
+	if (!queue || !fail || !delta || !output) {
+		fprintf(stderr, "error: malloc: %s\n", strerror(errno));
+		goto clean;
+	}
+
+	/* Substrings may start anywhere they fit, suffixes end with addresses */
+	if (automaton->flags & LEEK_AUTOMATON_ANYWHERE) {
+		automaton->gram_first = 0;
+		automaton->gram_count = LEEK_ADDRESS_LEN - automaton->len_min + 1;
+	}
+	else {
+		automaton->gram_first = LEEK_ADDRESS_LEN - LEEK_AUTOMATON_GRAM;
+		automaton->gram_count = 1;
+	}
+
+	queue[tail++] = 0;
+	while (head < tail) {
+		uint32_t state = queue[head++];
+		uint16_t *row = &automaton->trie[state * LEEK_AUTOMATON_SYMBOLS];
+		uint16_t *fallback = &automaton->trie[fail[state] * LEEK_AUTOMATON_SYMBOLS];
+
+		for (unsigned int s = 0; s < LEEK_AUTOMATON_SYMBOLS; ++s) {
+			uint32_t child = row[s];
+
+			if (!child) {
+				row[s] = state ? fallback[s] : 0;
+				continue;
+			}
+
+			fail[child] = state ? fallback[s] : 0;
+			if (!automaton->trie_output[child])
+				automaton->trie_output[child] = automaton->trie_output[fail[child]];
+			queue[tail++] = child;
+		}
+	}
+
+	memcpy(delta, automaton->trie, count * LEEK_AUTOMATON_SYMBOLS * sizeof(*delta));
+	memcpy(output, automaton->trie_output, count * sizeof(*output));
+
+	/* Nothing can undo a match anymore */
+	if (automaton->flags & LEEK_AUTOMATON_ANYWHERE) {
+		for (uint32_t state = 0; state < count; ++state) {
+			if (!output[state])
+				continue;
+			for (unsigned int s = 0; s < LEEK_AUTOMATON_SYMBOLS; ++s)
+				delta[state * LEEK_AUTOMATON_SYMBOLS + s] = state;
+		}
+	}
+
+	free(automaton->trie);
+	free(automaton->trie_output);
+	automaton->trie = NULL;
+	automaton->trie_output = NULL;
+	automaton->trie_max = 0;
+	automaton->delta = delta;
+	automaton->output = output;
+	delta = NULL;
+	output = NULL;
+
+	ret = 0;
+clean:
+	leek_region_free(output);
+	leek_region_free(delta);
+	free(fail);
+	free(queue);
+	return ret;
+}
+
+
+void leek_automaton_clean(struct leek_automaton *automaton)
+{
+	free(automaton->trie);
+	free(automaton->trie_output);
+	leek_region_free(automaton->delta);
+	leek_region_free(automaton->output);
+	leek_region_free(automaton->grams);
+	automaton->grams = NULL;
+	automaton->trie = NULL;
+	automaton->trie_output = NULL;
+	automaton->delta = NULL;
+	automaton->output = NULL;
+}
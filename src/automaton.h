@@ -0,0 +1,112 @@
+#ifndef __LEEK_AUTOMATON_H
+# define __LEEK_AUTOMATON_H
+# include <stdint.h>
+
+# include "helper.h"
+
+/* Dense rows: one transition per base32 symbol (64 bytes, one cache line) */
+# define LEEK_AUTOMATON_SYMBOLS     32
+# define LEEK_AUTOMATON_STATES_MAX  65536
+
+/* Addresses are first checked for the first (substring) or last (suffix)
+ * symbols of any word, a 'gram' (4 symbols make a 128KB bitmap) */
+# define LEEK_AUTOMATON_GRAM        4
+# define LEEK_AUTOMATON_GRAM_BITS   (LEEK_AUTOMATON_GRAM * LEEK_RAWADDR_CHAR_BITS)
+
+/* Automaton flags (see leek_automaton_init) */
+enum {
+	/* Words found anywhere are final (matching states loop on themselves) */
+	LEEK_AUTOMATON_ANYWHERE = (1 << 0),
+};
+
+/* Aho-Corasick automaton over base32 symbols, built as a complete DFA:
+ * after reading an address, 'output' tells the length of the longest word
+ * ending there (suffix mode) or of a word found anywhere (substring mode). */
+struct leek_automaton {
+	uint16_t *delta;
+	uint8_t *output;
+	uint32_t state_count;
+	unsigned int flags;
+
+	/* Grams of all words, checked at positions 'gram_first' and up to
+	 * 'gram_count' positions after it (see leek_automaton_prefilter) */
+	uint64_t *grams;
+	unsigned int gram_first;
+	unsigned int gram_count;
+	unsigned int len_min;
+
+	/* Words being loaded (freed once finalized) */
+	uint16_t *trie;
+	uint8_t *trie_output;
+	uint32_t trie_max;
+};
+
+/* Prepare an empty automaton (see flags above) */
+int leek_automaton_init(struct leek_automaton *automaton, unsigned int flags);
+
+/* Add a word given as base32 symbols (0 to 31, at least a gram long) */
+int leek_automaton_add(struct leek_automaton *automaton, const uint8_t *symbols,
+                       unsigned int length);
+
+/* Fill missing transitions and move everything to lookup regions */
+int leek_automaton_finalize(struct leek_automaton *automaton);
+
+/* Clean everything allocated by the functions above */
+void leek_automaton_clean(struct leek_automaton *automaton);
+
+
+/* Symbol 'i' of an address given as index and key (host order) */
+static inline unsigned int leek_automaton_symbol(uint16_t index, uint64_t key,
+                                                 unsigned int i)
+{
+	unsigned __int128 bits = ((unsigned __int128) index << 64) | key;
+	unsigned int shift = 8 * LEEK_RAWADDR_LEN - LEEK_RAWADDR_CHAR_BITS * (i + 1);
+
+	return (bits >> shift) & (LEEK_AUTOMATON_SYMBOLS - 1);
+}
+
+/* Tells whether a gram starts a word (or ends one in suffix mode) */
+static inline unsigned int leek_automaton_gram(const struct leek_automaton *automaton,
+                                               uint32_t gram)
+{
+	return (automaton->grams[gram / 64] >> (gram % 64)) & 1;
+}
+
+/* Tells whether an address may hold a word (see vecx.h for the batched version) */
+static inline unsigned int leek_automaton_prefilter(const struct leek_automaton *automaton,
+                                                    uint16_t index, uint64_t key)
+{
+	unsigned __int128 bits = ((unsigned __int128) index << 64) | key;
+	unsigned int found = 0;
+
+	for (unsigned int p = automaton->gram_first;
+	     p < automaton->gram_first + automaton->gram_count; ++p) {
+		unsigned int shift = 8 * LEEK_RAWADDR_LEN - LEEK_AUTOMATON_GRAM_BITS
+		                   - LEEK_RAWADDR_CHAR_BITS * p;
+
+		found |= leek_automaton_gram(automaton, (bits >> shift)
+		                                        & ((1U << LEEK_AUTOMATON_GRAM_BITS) - 1));
+	}
+
+	return found;
+}
+
+/* Runs the automaton over one address */
+static inline unsigned int leek_automaton_search(const struct leek_automaton *automaton,
+                                                 uint16_t index, uint64_t key)
+{
+	unsigned int state = 0;
+
+	if (!leek_automaton_prefilter(automaton, index, key))
+		return 0;
+
+	for (unsigned int i = 0; i < LEEK_ADDRESS_LEN; ++i) {
+		unsigned int symbol = leek_automaton_symbol(index, key, i);
+
+		state = automaton->delta[state * LEEK_AUTOMATON_SYMBOLS + symbol];
+	}
+
+	return automaton->output[state];
+}
+
+#endif /* !__LEEK_AUTOMATON_H */
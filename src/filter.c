@@ -0,0 +1,249 @@
+#include <errno.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "filter.h"
+#include "helper.h"
+
+
+static uint64_t leek_filter_splitmix64(uint64_t *state)
+{
+	uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return z ^ (z >> 31);
+}
+
+
+static int leek_filter_cmp(const void *a, const void *b)
+{
+	uint64_t ka = *(const uint64_t *) a;
+	uint64_t kb = *(const uint64_t *) b;
+
+	return (ka > kb) - (ka < kb);
+}
+
+
+/* Only needed when distinct keys collide on their hash */
+static size_t leek_filter_unique(uint64_t *keys, size_t count)
+{
+	size_t unique = 0;
+
+	qsort(keys, count, sizeof(*keys), leek_filter_cmp);
+	for (size_t j = 0; j < count; ++j) {
+		if (!unique || keys[j] != keys[unique - 1])
+			keys[unique++] = keys[j];
+	}
+	return unique;
+}
+
+
+/* Segment length and array size (parameters from the reference paper) */
+static void leek_filter_size(struct leek_filter *filter, uint32_t count)
+{
+	double factor;
+	uint32_t capacity;
+	uint32_t segments;
+
+	filter->segment_length = 1U << (int) floor(log(count) / log(3.33) + 2.25);
+	if (filter->segment_length > LEEK_FILTER_SEGMENT_MAX)
+		filter->segment_length = LEEK_FILTER_SEGMENT_MAX;
+	filter->segment_length_mask = filter->segment_length - 1;
+
+	factor = fmax(1.125, 0.875 + 0.25 * log(1000000.0) / log(count));
+	capacity = round(count * factor);
+
+	segments = (capacity + filter->segment_length - 1) / filter->segment_length;
+	segments = (segments > LEEK_FILTER_ARITY - 1) ? segments - (LEEK_FILTER_ARITY - 1) : 1;
+
+	filter->array_length = (segments + LEEK_FILTER_ARITY - 1) * filter->segment_length;
+	filter->segment_count_length = segments * filter->segment_length;
+}
+
+
+/* Peel the 3-partite hypergraph of key hashes: a position used by a single
+ * key is assigned last to this key ('stack' holds the reverse order). */
+int leek_filter_build(struct leek_filter *filter, uint64_t *keys, size_t count)
+{
+	uint64_t rng = 0x726B2B9D438B9D4DULL;
+	uint64_t *stack = NULL;
+	uint64_t *t2hash = NULL;
+	uint8_t *t2count = NULL;
+	uint8_t *stack_pos = NULL;
+	uint32_t *alone = NULL;
+	uint32_t *start = NULL;
+	uint32_t block_bits = 1;
+	uint32_t capacity;
+	uint32_t pos[5];
+	size_t depth = 0;
+	int ret = -1;
+
+	if (count < 2 || count > UINT32_MAX / 2) {
+		fprintf(stderr, "error: unsupported filter size (%zu).\n", count);
+		goto out;
+	}
+
+	leek_filter_size(filter, count);
+	capacity = filter->array_length;
+
+	while ((1U << block_bits) < filter->segment_count_length / filter->segment_length)
+		block_bits++;
+
+	filter->fingerprints = leek_region_alloc(capacity * sizeof(*filter->fingerprints));
+	stack = calloc(count + 1, sizeof(*stack));
+	t2hash = calloc(capacity, sizeof(*t2hash));
+	t2count = calloc(capacity, sizeof(*t2count));
+	stack_pos = malloc(count * sizeof(*stack_pos));
+	alone = malloc(capacity * sizeof(*alone));
+	start = malloc((1U << block_bits) * sizeof(*start));
+	if (   !filter->fingerprints || !stack || !t2hash || !t2count
+	    || !stack_pos || !alone || !start) {
+		fprintf(stderr, "error: malloc: %s\n", strerror(errno));
+		goto clean;
+	}
+
+	for (unsigned int iter = 0; ; ++iter) {
+		uint32_t duplicates = 0;
+		uint32_t queue = 0;
+		int error = 0;
+
+		if (iter == LEEK_FILTER_ITERATIONS) {
+			fprintf(stderr, "error: unable to build prefix filter.\n");
+			goto clean;
+		}
+
+		filter->seed = leek_filter_splitmix64(&rng);
+		memset(stack, 0, (count + 1) * sizeof(*stack));
+		memset(t2hash, 0, capacity * sizeof(*t2hash));
+		memset(t2count, 0, capacity * sizeof(*t2count));
+		stack[count] = 1;
+
+		/* Sort hashes by segment, so that the next loop stays cache friendly */
+		for (uint32_t b = 0; b < (1U << block_bits); ++b)
+			start[b] = ((uint64_t) b * count) >> block_bits;
+
+		for (size_t j = 0; j < count; ++j) {
+			uint64_t hash = leek_filter_murmur64(keys[j] + filter->seed);
+			uint32_t b = hash >> (64 - block_bits);
+
+			while (stack[start[b]])
+				b = (b + 1) & ((1U << block_bits) - 1);
+			stack[start[b]++] = hash;
+		}
+
+		/* Each position counts its keys (x4) and xors the probe number of them */
+		for (size_t j = 0; j < count; ++j) {
+			uint64_t hash = stack[j];
+
+			for (unsigned int i = 0; i < LEEK_FILTER_ARITY; ++i) {
+				pos[i] = leek_filter_position(filter, i, hash);
+				t2count[pos[i]] += 4;
+				t2count[pos[i]] ^= i;
+				t2hash[pos[i]] ^= hash;
+			}
+
+			/* Same hash twice leaves a position with two keys and no hash */
+			if ((t2hash[pos[0]] & t2hash[pos[1]] & t2hash[pos[2]]) == 0) {
+				if (   (!t2hash[pos[0]] && t2count[pos[0]] == 8)
+				    || (!t2hash[pos[1]] && t2count[pos[1]] == 8)
+				    || (!t2hash[pos[2]] && t2count[pos[2]] == 8)) {
+					duplicates++;
+					for (unsigned int i = 0; i < LEEK_FILTER_ARITY; ++i) {
+						t2count[pos[i]] -= 4;
+						t2count[pos[i]] ^= i;
+						t2hash[pos[i]] ^= hash;
+					}
+				}
+			}
+
+			for (unsigned int i = 0; i < LEEK_FILTER_ARITY; ++i)
+				error |= (t2count[pos[i]] < 4);
+		}
+
+		if (error)
+			continue;
+
+		for (uint32_t p = 0; p < capacity; ++p) {
+			alone[queue] = p;
+			queue += ((t2count[p] >> 2) == 1);
+		}
+
+		depth = 0;
+		while (queue > 0) {
+			uint32_t p = alone[--queue];
+			uint64_t hash;
+			uint8_t found;
+
+			if ((t2count[p] >> 2) != 1)
+				continue;
+
+			hash = t2hash[p];
+			found = t2count[p] & 3;
+			for (unsigned int i = 0; i < LEEK_FILTER_ARITY; ++i)
+				pos[i] = leek_filter_position(filter, i, hash);
+			pos[3] = pos[0];
+			pos[4] = pos[1];
+
+			stack_pos[depth] = found;
+			stack[depth++] = hash;
+
+			for (unsigned int i = 1; i < LEEK_FILTER_ARITY; ++i) {
+				uint32_t other = pos[found + i];
+				unsigned int probe = (found + i) % LEEK_FILTER_ARITY;
+
+				alone[queue] = other;
+				queue += ((t2count[other] >> 2) == 2);
+				t2count[other] -= 4;
+				t2count[other] ^= probe;
+				t2hash[other] ^= hash;
+			}
+		}
+
+		if (depth + duplicates == count)
+			break;
+
+		if (duplicates)
+			count = leek_filter_unique(keys, count);
+	}
+
+	/* Assign fingerprints in reverse peeling order */
+	for (size_t j = depth; j-- > 0; ) {
+		uint64_t hash = stack[j];
+		uint8_t found = stack_pos[j];
+		uint8_t f = hash ^ (hash >> 32);
+
+		for (unsigned int i = 0; i < LEEK_FILTER_ARITY; ++i)
+			pos[i] = leek_filter_position(filter, i, hash);
+		pos[3] = pos[0];
+		pos[4] = pos[1];
+
+		f ^= filter->fingerprints[pos[found + 1]] ^ filter->fingerprints[pos[found + 2]];
+		filter->fingerprints[pos[found]] = f;
+	}
+
+	ret = 0;
+clean:
+	free(start);
+	free(alone);
+	free(stack_pos);
+	free(t2count);
+	free(t2hash);
+	free(stack);
+	if (ret < 0) {
+		leek_region_free(filter->fingerprints);
+		filter->fingerprints = NULL;
+	}
+out:
+	return ret;
+}
+
+
+void leek_filter_clean(struct leek_filter *filter)
+{
+	leek_region_free(filter->fingerprints);
+	filter->fingerprints = NULL;
+}
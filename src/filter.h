@@ -0,0 +1,82 @@
+#ifndef __LEEK_FILTER_H
+# define __LEEK_FILTER_H
+# include <stddef.h>
+# include <stdint.h>
+
+/* Binary fuse filter with 8 bits fingerprints (3 probes per lookup).
+ * This uses about 9 bits per key with a false positive rate of 1/256.
+ * See "Binary Fuse Filters: Fast and Smaller Than Xor Filters" (Graf & Lemire) */
+# define LEEK_FILTER_ARITY          3
+# define LEEK_FILTER_SEGMENT_MAX    (1U << 18)
+# define LEEK_FILTER_ITERATIONS     100
+
+struct leek_filter {
+	uint64_t seed;
+	uint32_t segment_length;
+	uint32_t segment_length_mask;
+	uint32_t segment_count_length;
+	uint32_t array_length;
+	uint8_t *fingerprints;
+
+	/* Lookups that went through the filter and were not in the index */
+	struct {
+		uint64_t passed;
+		uint64_t false_positives;
+	} stats;
+};
+
+/* Build the filter from a set of keys (keys may be reordered) */
+int leek_filter_build(struct leek_filter *filter, uint64_t *keys, size_t count);
+
+/* Clean everything allocated by leek_filter_build */
+void leek_filter_clean(struct leek_filter *filter);
+
+
+static inline uint64_t leek_filter_murmur64(uint64_t h)
+{
+	h ^= h >> 33;
+	h *= 0xFF51AFD7ED558CCDULL;
+	h ^= h >> 33;
+	h *= 0xC4CEB9FE1A85EC53ULL;
+	h ^= h >> 33;
+
+	return h;
+}
+
+/* Position of the i-th probe (one in each of 3 consecutive segments) */
+static inline uint32_t leek_filter_position(const struct leek_filter *filter,
+                                            unsigned int i, uint64_t hash)
+{
+	uint64_t h = ((__uint128_t) hash * filter->segment_count_length) >> 64;
+	uint64_t hh = hash & ((1ULL << 36) - 1);
+
+	h += i * filter->segment_length;
+	h ^= (hh >> (36 - 18 * i)) & filter->segment_length_mask;
+
+	return h;
+}
+
+/* Tells whether key may be in the set (always true when it is) */
+static inline unsigned int leek_filter_contains(const struct leek_filter *filter,
+                                                uint64_t key)
+{
+	uint64_t hash = leek_filter_murmur64(key + filter->seed);
+	uint8_t f = hash ^ (hash >> 32);
+
+	f ^= filter->fingerprints[leek_filter_position(filter, 0, hash)];
+	f ^= filter->fingerprints[leek_filter_position(filter, 1, hash)];
+	f ^= filter->fingerprints[leek_filter_position(filter, 2, hash)];
+
+	return f == 0;
+}
+
+/* Brings all probes of key in cache ahead of leek_filter_contains */
+static inline void leek_filter_prefetch(const struct leek_filter *filter, uint64_t key)
+{
+	uint64_t hash = leek_filter_murmur64(key + filter->seed);
+
+	for (unsigned int i = 0; i < LEEK_FILTER_ARITY; ++i)
+		__builtin_prefetch(&filter->fingerprints[leek_filter_position(filter, i, hash)]);
+}
+
+#endif /* !__LEEK_FILTER_H */
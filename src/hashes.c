@@ -1,4 +1,7 @@
+#include <endian.h>
 #include <errno.h>
+#include <inttypes.h>
+#include <limits.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -66,28 +69,37 @@ static int leek_address_check(unsigned int len, const char *word)
 }
 
 
-static int leek_hash_bucket_enqueue(const union leek_rawaddr *addr)
+static int leek_hash_load_enqueue(const union leek_rawaddr *addr, unsigned int len)
 {
-	struct leek_hash_bucket *bucket;
-	unsigned int cur_count;
-	uint64_t *ptr;
+	struct leek_hash_entry *entry;
+	struct leek_hash_entry *ptr;
+	uint16_t index;
+	uint64_t key;
+	size_t max;
 	int ret = -1;
 
-	bucket = &leek.hashes.bucket[addr->index];
-	cur_count = bucket->cur_count;
-
-	if (cur_count == bucket->max_count) {
-		ptr = realloc(bucket->data, (cur_count + LEEK_HASH_BUCKETS_INC) * sizeof(*bucket->data));
+	if (leek.hashes.load_count == leek.hashes.load_max) {
+		max = 2 * leek.hashes.load_max + LEEK_HASH_LOAD_INC;
+		ptr = realloc(leek.hashes.load, max * sizeof(*ptr));
 		if (!ptr) {
 			fprintf(stderr, "error: realloc: %s\n", strerror(errno));
 			goto out;
 		}
-		bucket->max_count += LEEK_HASH_BUCKETS_INC;
-		bucket->data = ptr;
+		leek.hashes.load_max = max;
+		leek.hashes.load = ptr;
 	}
-	bucket->data[cur_count] = addr->suffix;
-	bucket->cur_count++;
-	bucket->flags &= ~LEEK_HASH_BUCKET_SORTED;
+
+	index = be16toh(addr->index);
+	key = be64toh(addr->suffix);
+
+	/* All variants of a prefix are loaded as a single folded one */
+	if (leek.hashes.fold_count)
+		leek_hashes_fold(&leek.hashes, len, &index, &key);
+
+	entry = &leek.hashes.load[leek.hashes.load_count++];
+	entry->key = key & leek_hash_key_mask(len);
+	entry->index = index;
+	entry->length = len;
 
 	ret = 0;
 out:
@@ -95,67 +107,539 @@ out:
 }
 
 
+/* Entries are sorted in address order, then by length (shortest first) */
 static int leek_hashes_cmp(const void *a, const void *b)
 {
-	const uint64_t *va = a;
-	const uint64_t *vb = b;
-
-	if (*va > *vb)
-		return +1;
-	if (*va < *vb)
-		return -1;
+	const struct leek_hash_entry *ea = a;
+	const struct leek_hash_entry *eb = b;
+
+	if (ea->index != eb->index)
+		return (ea->index > eb->index) ? +1 : -1;
+	if (ea->key != eb->key)
+		return (ea->key > eb->key) ? +1 : -1;
+	if (ea->length != eb->length)
+		return (ea->length > eb->length) ? +1 : -1;
 	return 0;
 }
 
 
-static void leek_hashes_bucket_sort(struct leek_hash_bucket *bucket)
+/* Sort loaded entries and remove duplicates (in place) */
+static void leek_hashes_load_sort(void)
+{
+	struct leek_hash_entry *load = leek.hashes.load;
+	size_t count = 0;
+
+	qsort(load, leek.hashes.load_count, sizeof(*load), leek_hashes_cmp);
+
+	for (size_t j = 0; j < leek.hashes.load_count; ++j) {
+		if (count && !leek_hashes_cmp(&load[j], &load[count - 1])) {
+			leek.hashes.stats.length[load[j].length - 1]--;
+			leek.hashes.stats.duplicates++;
+			continue;
+		}
+		load[count++] = load[j];
+	}
+
+	leek.hashes.load_count = count;
+	leek.hashes.stats.valids = count;
+
+	/* Give back unused space before the index is allocated */
+	if (count && (load = realloc(leek.hashes.load, count * sizeof(*load)))) {
+		leek.hashes.load = load;
+		leek.hashes.load_max = count;
+	}
+}
+
+
+/* Directory width keeps about LEEK_HASH_SLOT_KEYS keys per slot,
+ * but slots can never be longer than the shortest prefix. */
+static unsigned int leek_hashes_index_bits(void)
 {
-	unsigned int duplicates = 0;
-	unsigned int count;
+	unsigned int bits = LEEK_HASH_INDEX_MIN;
+	unsigned int bits_max = LEEK_HASH_INDEX_MAX;
+
+	if (bits_max > 5 * leek.hashes.stats.len_min)
+		bits_max = 5 * leek.hashes.stats.len_min;
+
+	while (bits < bits_max && (leek.hashes.load_count >> bits) >= LEEK_HASH_SLOT_KEYS)
+		bits++;
+
+	return bits;
+}
+
 
-	count = bucket->cur_count;
-	if (count) {
-		/* By design, duplicates are not possible here but we're being safe */
-		qsort(bucket->data, count, sizeof *bucket->data, leek_hashes_cmp);
-		for (unsigned int j = 1; j < count; ++j) {
-			if (bucket->data[j] == bucket->data[j - 1]) {
-				bucket->data[j - 1] = 0xFFFFFFFFFFFFFFFFUL;
-				duplicates++;
+/* Build the compressed sparse row index from sorted loaded entries.
+ * Each entry is also linked to the longest entry that is its prefix:
+ * in a sorted slot, prefixes of an entry are all on the stack of previous
+ * entries that are still prefixes of the current one. */
+static int leek_hashes_index_build(void)
+{
+	size_t count = leek.hashes.load_count;
+	unsigned int bits = leek_hashes_index_bits();
+	uint32_t slots = 1U << bits;
+	uint32_t slot = 0;
+	uint32_t top = 0;
+	int ret = -1;
+
+	leek.hashes.index_bits = bits;
+	leek.hashes.offsets = leek_region_alloc((slots + 1) * sizeof(*leek.hashes.offsets));
+	leek.hashes.keys = leek_region_alloc(count * sizeof(*leek.hashes.keys));
+	leek.hashes.links = leek_region_alloc(count * sizeof(*leek.hashes.links));
+	if (!leek.hashes.offsets || !leek.hashes.keys || !leek.hashes.links)
+		goto out;
+
+	leek.hashes.offsets[0] = 0;
+	for (uint32_t j = 0; j < count; ++j) {
+		const struct leek_hash_entry *entry = &leek.hashes.load[j];
+		uint32_t entry_slot = leek_hashes_slot(&leek.hashes, entry->index, entry->key);
+		uint32_t parent = 0;
+
+		/* Close all slots up to this one, stack is reset with the slot */
+		if (entry_slot != slot) {
+			while (slot < entry_slot)
+				leek.hashes.offsets[++slot] = j;
+			top = j;
+		}
+
+		while (top > leek.hashes.offsets[slot]) {
+			uint32_t link = leek.hashes.links[top - 1];
+			uint64_t mask = leek_hash_key_mask(LEEK_HASH_LINK_LENGTH(link));
+
+			if ((entry->key & mask) == leek.hashes.keys[top - 1]) {
+				parent = j - (top - 1);
+				break;
 			}
+			if (!LEEK_HASH_LINK_PARENT(link))
+				break;
+			top -= LEEK_HASH_LINK_PARENT(link);
 		}
 
-		if (duplicates) {
-			qsort(bucket->data, count, sizeof *bucket->data, leek_hashes_cmp);
-			bucket->cur_count -= duplicates;
-			count = bucket->cur_count;
+		leek.hashes.keys[j] = entry->key;
+		leek.hashes.links[j] = (parent << LEEK_HASH_LINK_BITS) | entry->length;
+		top = j + 1;
+	}
+
+	while (slot < slots)
+		leek.hashes.offsets[++slot] = count;
+
+	leek.hashes.stats.index_size = (slots + 1) * sizeof(*leek.hashes.offsets)
+	                             + count * sizeof(*leek.hashes.keys)
+	                             + count * sizeof(*leek.hashes.links);
+	ret = 0;
+out:
+	return ret;
+}
+
+
+/* Bits needed to store any value up to 'value' */
+static unsigned int leek_hashes_bits(uint32_t value)
+{
+	return value ? 32 - __builtin_clz(value) : 0;
+}
+
+
+/* Replace index keys and links with compact entries (see hashes.h).
+ * Address bits covered by the slot are not stored, only the following ones
+ * up to the longest prefix. Index stays as is when entries are too wide. */
+static int leek_hashes_pack(void)
+{
+	size_t count = leek.hashes.stats.valids;
+	unsigned int bits = leek.hashes.index_bits;
+	unsigned int key_bits = LEEK_RAWADDR_CHAR_BITS * leek.hashes.stats.len_max - bits;
+	unsigned int length_bits;
+	unsigned int parent_bits;
+	uint32_t parent_max = 0;
+	size_t size;
+	int ret = -1;
+
+	for (size_t j = 0; j < count; ++j) {
+		uint32_t parent = LEEK_HASH_LINK_PARENT(leek.hashes.links[j]);
+		parent_max = (parent > parent_max) ? parent : parent_max;
+	}
+
+	length_bits = leek_hashes_bits(leek.hashes.stats.len_max - leek.hashes.stats.len_min);
+	parent_bits = leek_hashes_bits(parent_max);
+
+	if (key_bits + length_bits + parent_bits > LEEK_HASH_PACKED_MAX) {
+		fprintf(stderr, "warning: prefixes are too long for a compact index.\n");
+		ret = 0;
+		goto out;
+	}
+
+	/* Last entry is read with a full 64 bits load */
+	size = (count * (key_bits + length_bits + parent_bits) + 7) / 8 + sizeof(uint64_t);
+	leek.hashes.packed = leek_region_alloc(size);
+	if (!leek.hashes.packed)
+		goto out;
+
+	leek.hashes.packed_bits = key_bits + length_bits + parent_bits;
+	leek.hashes.packed_key_bits = key_bits;
+	leek.hashes.packed_length_bits = length_bits;
+	leek.hashes.packed_parent_bits = parent_bits;
+
+	for (size_t j = 0; j < count; ++j) {
+		uint64_t bit = j * leek.hashes.packed_bits;
+		uint32_t link = leek.hashes.links[j];
+		uint64_t entry = 0;
+		uint64_t word;
+
+		if (key_bits)
+			entry = (leek.hashes.keys[j] << (bits - 16)) >> (64 - key_bits);
+		entry = (entry << length_bits) | (LEEK_HASH_LINK_LENGTH(link) - leek.hashes.stats.len_min);
+		entry = (entry << parent_bits) | LEEK_HASH_LINK_PARENT(link);
+
+		memcpy(&word, &leek.hashes.packed[bit / 8], sizeof(word));
+		word = htole64(le64toh(word) | (entry << (bit % 8)));
+		memcpy(&leek.hashes.packed[bit / 8], &word, sizeof(word));
+	}
+
+	leek_region_free(leek.hashes.keys);
+	leek_region_free(leek.hashes.links);
+	leek.hashes.keys = NULL;
+	leek.hashes.links = NULL;
+
+	leek.hashes.stats.index_size = ((1U << bits) + 1) * sizeof(*leek.hashes.offsets) + size;
+	ret = 0;
+out:
+	return ret;
+}
+
+
+/* Insert a key in the cuckoo table, moving other keys to their alternate
+ * bucket when both candidates are full (random walk). */
+static int leek_hashes_table_insert(uint16_t index, uint64_t key, uint64_t *seed)
+{
+	struct leek_hash_table_bucket *prev = NULL;
+
+	for (unsigned int kick = 0; kick < LEEK_HASH_TABLE_KICKS; ++kick) {
+		uint64_t hash = leek_hashes_table_hash(index, key);
+		struct leek_hash_table_bucket *b1;
+		struct leek_hash_table_bucket *b2;
+		struct leek_hash_table_bucket *b;
+		unsigned int way;
+		uint64_t tmp_key;
+		uint16_t tmp_index;
+
+		b1 = &leek.hashes.table[leek_hashes_table_bucket(&leek.hashes, hash)];
+		b2 = &leek.hashes.table[leek_hashes_table_bucket(&leek.hashes, hash >> 32)];
+
+		if (b1->count < LEEK_HASH_TABLE_WAYS)
+			b = b1;
+		else if (b2->count < LEEK_HASH_TABLE_WAYS)
+			b = b2;
+		else {
+			/* Evict a random key, never back to where it came from */
+			b = (b1 == prev) ? b2 : b1;
+			*seed ^= *seed << 13;
+			*seed ^= *seed >> 7;
+			*seed ^= *seed << 17;
+			way = *seed % LEEK_HASH_TABLE_WAYS;
+
+			tmp_key = b->keys[way];
+			tmp_index = b->index[way];
+			b->keys[way] = key;
+			b->index[way] = index;
+			key = tmp_key;
+			index = tmp_index;
+			prev = b;
+			continue;
 		}
-		bucket->flags |= LEEK_HASH_BUCKET_SORTED;
 
-		leek.hashes.stats.duplicates += duplicates;
-		leek.hashes.stats.valids += count;
+		b->keys[b->count] = key;
+		b->index[b->count] = index;
+		b->count++;
+		return 0;
 	}
+
+	return -1;
 }
 
 
-static int leek_address_lookup(const union leek_rawaddr *addr)
+/* Build the cuckoo table from loaded entries (all with the same length).
+ * Buckets are added until every key finds a place. */
+static int leek_hashes_table_build(void)
 {
-	struct leek_hash_bucket *bucket = &leek.hashes.bucket[addr->index];
+	size_t count = leek.hashes.load_count;
+	size_t buckets = (count * 100) / (LEEK_HASH_TABLE_WAYS * LEEK_HASH_TABLE_LOAD) + 1;
+	uint64_t seed = 0x2545F4914F6CDD1DULL;
+	int ret = -1;
+
+	leek.hashes.table_length = leek.hashes.stats.len_min;
 
-	if (bucket->cur_count) {
-		if (bucket->flags & LEEK_HASH_BUCKET_SORTED)
-			leek_hashes_bucket_sort(bucket);
-		return leek_bucket_lookup(bucket, addr->suffix);
+retry:
+	if (buckets > UINT32_MAX) {
+		fprintf(stderr, "error: too many prefixes for a cuckoo table.\n");
+		goto out;
 	}
 
-	return 0;
+	leek_region_free(leek.hashes.table);
+	leek.hashes.table_buckets = buckets;
+	leek.hashes.table = leek_region_alloc(buckets * sizeof(*leek.hashes.table));
+	if (!leek.hashes.table)
+		goto out;
+
+	for (size_t j = 0; j < count; ++j) {
+		const struct leek_hash_entry *entry = &leek.hashes.load[j];
+
+		if (leek_hashes_table_insert(entry->index, entry->key, &seed) < 0) {
+			buckets += buckets / 8 + 1;
+			goto retry;
+		}
+	}
+
+	leek.hashes.stats.index_size = buckets * sizeof(*leek.hashes.table);
+	ret = 0;
+out:
+	return ret;
 }
 
 
-/* Defines positive return codes for the following function */
+/* Build the filter on loaded entries cut to the shortest prefix length
+ * (entries are sorted, cut duplicates are adjacent). */
+static int leek_hashes_filter_build(void)
+{
+	uint64_t mask = leek_hash_key_mask(leek.hashes.stats.len_min);
+	uint64_t *keys;
+	size_t count = 0;
+	int ret = -1;
+
+	keys = malloc(leek.hashes.load_count * sizeof(*keys));
+	if (!keys) {
+		fprintf(stderr, "error: malloc: %s\n", strerror(errno));
+		goto out;
+	}
+
+	for (size_t j = 0; j < leek.hashes.load_count; ++j) {
+		const struct leek_hash_entry *entry = &leek.hashes.load[j];
+		uint64_t key = leek_hashes_filter_key(entry->index, entry->key & mask);
+
+		if (!count || key != keys[count - 1])
+			keys[count++] = key;
+	}
+
+	ret = leek_filter_build(&leek.hashes.filter, keys, count);
+	free(keys);
+out:
+	return ret;
+}
+
+
+/* Route each bucket index to the patterns it may match (and fill the bitmap) */
+static int leek_hashes_pattern_build(void)
+{
+	const struct leek_pattern *patterns = leek.hashes.patterns;
+	unsigned int count = leek.hashes.pattern_count;
+	uint32_t *offsets;
+	uint32_t *routes = NULL;
+	uint64_t total = 0;
+	int ret = -1;
+
+	offsets = leek_region_alloc((LEEK_HASH_BUCKETS + 1) * sizeof(*offsets));
+	if (!offsets) {
+		fprintf(stderr, "error: malloc: %s\n", strerror(errno));
+		goto out;
+	}
+
+	for (uint32_t i = 0; i < LEEK_HASH_BUCKETS; ++i) {
+		offsets[i] = total;
+		for (unsigned int j = 0; j < count; ++j)
+			total += leek_pattern_index_match(&patterns[j], i);
+
+		if (total > UINT32_MAX) {
+			fprintf(stderr, "error: too many patterns starting with wildcards.\n");
+			goto clean;
+		}
+	}
+	offsets[LEEK_HASH_BUCKETS] = total;
+
+	routes = leek_region_alloc(total * sizeof(*routes));
+	if (!routes) {
+		fprintf(stderr, "error: malloc: %s\n", strerror(errno));
+		goto clean;
+	}
+
+	for (uint32_t i = 0; i < LEEK_HASH_BUCKETS; ++i) {
+		uint16_t index = htobe16(i);
+		uint32_t k = offsets[i];
+
+		for (unsigned int j = 0; j < count; ++j) {
+			if (leek_pattern_index_match(&patterns[j], i))
+				routes[k++] = j;
+		}
+
+		if (offsets[i + 1] > offsets[i])
+			leek.hashes.bitmap[index / 64] |= (1ULL << (index % 64));
+	}
+
+	leek.hashes.pattern_offsets = offsets;
+	leek.hashes.pattern_routes = routes;
+	leek.hashes.stats.index_size = (LEEK_HASH_BUCKETS + 1) * sizeof(*offsets)
+	                             + total * sizeof(*routes)
+	                             + count * sizeof(*patterns);
+	ret = 0;
+clean:
+	if (ret < 0)
+		leek_region_free(offsets);
+out:
+	return ret;
+}
+
+
+/* Words are added to the automaton as symbols read back from entries */
+static int leek_hashes_automaton_build(void)
+{
+	struct leek_automaton *automaton = &leek.hashes.automaton;
+	unsigned int flags = 0;
+	int ret = -1;
+
+	if (leek.options.flags & LEEK_OPTION_SUBSTRING)
+		flags |= LEEK_AUTOMATON_ANYWHERE;
+
+	ret = leek_automaton_init(automaton, flags);
+	if (ret < 0)
+		goto out;
+
+	for (size_t j = 0; j < leek.hashes.load_count; ++j) {
+		const struct leek_hash_entry *entry = &leek.hashes.load[j];
+		uint8_t symbols[LEEK_ADDRESS_LEN];
+
+		for (unsigned int i = 0; i < entry->length; ++i)
+			symbols[i] = leek_automaton_symbol(entry->index, entry->key, i);
+
+		ret = leek_automaton_add(automaton, symbols, entry->length);
+		if (ret < 0)
+			goto out;
+	}
+
+	ret = leek_automaton_finalize(automaton);
+	if (ret < 0)
+		goto out;
+
+	/* Any address may hold a word */
+	memset(leek.hashes.bitmap, 0xFF, sizeof(leek.hashes.bitmap));
+
+	leek.hashes.stats.index_size = automaton->state_count
+	                             * (LEEK_AUTOMATON_SYMBOLS * sizeof(*automaton->delta)
+	                                + sizeof(*automaton->output))
+	                             + (1U << LEEK_AUTOMATON_GRAM_BITS) / 8;
+out:
+	return ret;
+}
+
+
+/* Bitmap of raw addresses with folded prefixes (see --variants):
+ * the first 4 symbols of all loaded prefixes are marked in a temporary
+ * bitmap, then each raw bucket index is set when any address starting with
+ * it folds on a marked head (the 4th symbol is only partly in the index). */
+static int leek_hashes_fold_bitmap(void)
+{
+	const unsigned int bits = 4 * LEEK_RAWADDR_CHAR_BITS;
+	uint64_t *heads;
+	int ret = -1;
+
+	heads = calloc((1U << bits) / 64, sizeof(*heads));
+	if (!heads) {
+		fprintf(stderr, "error: calloc: %s\n", strerror(errno));
+		goto out;
+	}
+
+	for (size_t j = 0; j < leek.hashes.load_count; ++j) {
+		const struct leek_hash_entry *entry = &leek.hashes.load[j];
+		uint32_t head = ((uint32_t) entry->index << (bits - 16)) | (entry->key >> (64 - bits + 16));
+
+		heads[head / 64] |= (1ULL << (head % 64));
+	}
+
+	for (uint32_t head = 0; head < (1U << bits); ++head) {
+		uint32_t folded = 0;
+		uint16_t index;
+
+		for (unsigned int i = 0; i < 4; ++i) {
+			unsigned int shift = bits - LEEK_RAWADDR_CHAR_BITS * (i + 1);
+
+			folded |= (uint32_t) leek.hashes.fold[(head >> shift) & (LEEK_BASE32_SYMBOLS - 1)] << shift;
+		}
+
+		if (!((heads[folded / 64] >> (folded % 64)) & 1))
+			continue;
+
+		index = htobe16(head >> (bits - 16));
+		leek.hashes.bitmap[index / 64] |= (1ULL << (index % 64));
+	}
+
+	free(heads);
+	ret = 0;
+out:
+	return ret;
+}
+
+
+/* Build the lookup index from loaded entries (then released) */
+static int leek_hashes_build(void)
+{
+	uint64_t start = leek_timestamp();
+	int best;
+	int ret;
+
+	if (leek.options.flags & (LEEK_OPTION_SUBSTRING | LEEK_OPTION_SUFFIX)) {
+		ret = leek_hashes_automaton_build();
+		goto out;
+	}
+
+	if (leek.hashes.pattern_count) {
+		ret = leek_hashes_pattern_build();
+		goto out;
+	}
+
+	/* Partial matches need the sorted index (see leek_result_lookup_best) */
+	best = !!(leek.options.flags & LEEK_OPTION_BEST);
+
+	if (leek.hashes.load_count >= LEEK_HASH_FILTER_MIN && !best) {
+		ret = leek_hashes_filter_build();
+		if (ret < 0)
+			goto out;
+	}
+
+	/* Lookups first probe this bitmap (fits in L1) */
+	if (leek.hashes.fold_count) {
+		ret = leek_hashes_fold_bitmap();
+		if (ret < 0)
+			goto out;
+	}
+	else {
+		for (size_t j = 0; j < leek.hashes.load_count; ++j) {
+			uint16_t index = htobe16(leek.hashes.load[j].index);
+
+			leek.hashes.bitmap[index / 64] |= (1ULL << (index % 64));
+		}
+	}
+
+	/* Cuckoo table is not compressed, it is only used by default */
+	if (leek.options.flags & LEEK_OPTION_COMPACT) {
+		ret = leek_hashes_index_build();
+		if (ret == 0)
+			ret = leek_hashes_pack();
+	}
+	else if (leek.hashes.stats.len_min == leek.hashes.stats.len_max && !best)
+		ret = leek_hashes_table_build();
+	else
+		ret = leek_hashes_index_build();
+
+out:
+	free(leek.hashes.load);
+	leek.hashes.load = NULL;
+	leek.hashes.load_max = 0;
+
+	leek.hashes.stats.index_time = leek_timestamp() - start;
+	return ret;
+}
+
+
+/* Defines positive return codes for the following functions */
 enum {
 	LEEK_HASH_ENQUEUE_INVALID   = 0,
-	LEEK_HASH_ENQUEUE_DUPLICATE = 1,
-	LEEK_HASH_ENQUEUE_SUCCESS   = 2,
+	LEEK_HASH_ENQUEUE_SUCCESS   = 1,
+	LEEK_HASH_ENQUEUE_FILTERED  = 2,
 };
 
 
@@ -167,18 +651,12 @@ static int leek_hash_enqueue(unsigned int len, const char *word)
 	if (leek_address_check(len, word)) {
 		leek_base32_convert(addr.buffer, word);
 
-		/* Only enqueue when no there is no duplicate */
-		if (!leek_address_lookup(&addr)) {
-			ret = leek_hash_bucket_enqueue(&addr);
-			if (ret < 0)
-				goto out;
+		/* Duplicates are removed once everything is loaded */
+		ret = leek_hash_load_enqueue(&addr, len);
+		if (ret < 0)
+			goto out;
 
-			ret = LEEK_HASH_ENQUEUE_SUCCESS;
-		}
-		else {
-			leek.hashes.stats.duplicates++;
-			ret = LEEK_HASH_ENQUEUE_DUPLICATE;
-		}
+		ret = LEEK_HASH_ENQUEUE_SUCCESS;
 	}
 	else {
 		leek.hashes.stats.invalids++;
@@ -190,6 +668,49 @@ out:
 }
 
 
+/* Compile a pattern (--pattern), length is set to the compiled length */
+static int leek_hash_pattern_enqueue(const char *word, unsigned int *length)
+{
+	struct leek_pattern pattern;
+	struct leek_pattern *ptr;
+	unsigned int max;
+	int ret = -1;
+
+	if (leek_pattern_compile(&pattern, word) < 0) {
+		leek.hashes.stats.invalids++;
+		ret = LEEK_HASH_ENQUEUE_INVALID;
+		goto out;
+	}
+
+	if (pattern.length < leek.options.len_min || pattern.length > leek.options.len_max) {
+		leek.hashes.stats.filtered++;
+		ret = LEEK_HASH_ENQUEUE_FILTERED;
+		goto out;
+	}
+
+	/* Patterns are kept as they are loaded (no realloc on regions) */
+	if (leek.hashes.pattern_count == leek.hashes.pattern_max) {
+		max = 2 * leek.hashes.pattern_max + LEEK_HASH_MATCH_MAX;
+		ptr = leek_region_alloc(max * sizeof(*ptr));
+		if (!ptr) {
+			fprintf(stderr, "error: malloc: %s\n", strerror(errno));
+			goto out;
+		}
+		if (leek.hashes.patterns)
+			memcpy(ptr, leek.hashes.patterns, leek.hashes.pattern_count * sizeof(*ptr));
+		leek_region_free(leek.hashes.patterns);
+		leek.hashes.pattern_max = max;
+		leek.hashes.patterns = ptr;
+	}
+
+	leek.hashes.patterns[leek.hashes.pattern_count++] = pattern;
+	*length = pattern.length;
+	ret = LEEK_HASH_ENQUEUE_SUCCESS;
+out:
+	return ret;
+}
+
+
 static int leek_hashes_readfp(FILE *fp)
 {
 	size_t line_size = LEEK_ADDRESS_LEN + 1;
@@ -224,23 +745,23 @@ static int leek_hashes_readfp(FILE *fp)
 		for (unsigned int i = length + 1; i < LEEK_ADDRESS_LEN + 1; ++i)
 			line[i] = 0;
 
-		if (length < leek.options.len_min || length > leek.options.len_max)
+		/* Patterns are filtered on their compiled length */
+		if (leek.options.flags & LEEK_OPTION_PATTERN)
+			ret = leek_hash_pattern_enqueue(line, &length);
+		else if (length < leek.options.len_min || length > leek.options.len_max) {
 			leek.hashes.stats.filtered++;
-		else {
+			continue;
+		}
+		else
 			ret = leek_hash_enqueue(length, line);
-			if (ret < 0)
-				goto line_free;
-
-			/* No break here, this is intended */
-			switch (ret) {
-				case LEEK_HASH_ENQUEUE_SUCCESS:
-					leek.hashes.stats.length[length - 1]++;
-				/* fall-through */
-
-				case LEEK_HASH_ENQUEUE_DUPLICATE:
-					len_min = (length < len_min) ? length : len_min;
-					len_max = (length > len_max) ? length : len_max;
-			}
+
+		if (ret < 0)
+			goto line_free;
+
+		if (ret == LEEK_HASH_ENQUEUE_SUCCESS) {
+			leek.hashes.stats.length[length - 1]++;
+			len_min = (length < len_min) ? length : len_min;
+			len_max = (length > len_max) ? length : len_max;
 		}
 	}
 
@@ -281,10 +802,18 @@ out:
 /* Add a single item to the 'hashlist' (--prefix option) */
 static int leek_hash_add(const char *word)
 {
-	size_t length = strlen(word);
+	unsigned int length = strlen(word);
 	int ret = 0;
 
-	if (length < leek.options.len_min || length > leek.options.len_max)
+	if (leek.options.flags & LEEK_OPTION_PATTERN) {
+		ret = leek_hash_pattern_enqueue(word, &length);
+		if (ret == LEEK_HASH_ENQUEUE_SUCCESS) {
+			leek.hashes.stats.length[length - 1]++;
+			leek.hashes.stats.len_min = length;
+			leek.hashes.stats.len_max = length;
+		}
+	}
+	else if (length < leek.options.len_min || length > leek.options.len_max)
 		leek.hashes.stats.filtered++;
 	else {
 		char buffer[LEEK_ADDRESS_LEN + 1] = { 0 };
@@ -306,10 +835,39 @@ out:
 }
 
 
-static void leek_hashes_sort(void)
+/* Build the list of first address words for small target sets.
+ * Bits after the shortest prefix are ignored for all targets so that
+ * this is a superset of all possible matches (full lookup still applies). */
+static void leek_hashes_match_build(void)
 {
-	for (unsigned int i = 0; i < LEEK_HASH_BUCKETS; ++i)
-		leek_hashes_bucket_sort(&leek.hashes.bucket[i]);
+	uint32_t mask = ~(leek_hash_key_mask(leek.options.len_min) >> 48) & 0xFFFF;
+	unsigned int count = 0;
+
+	leek.hashes.match_count = 0;
+	if (leek.hashes.stats.valids > LEEK_HASH_MATCH_MAX)
+		return;
+
+	/* Words are not only found at the start of addresses, partial matches
+	 * are needed as well (see --best) or addresses need to be folded first */
+	if (leek.options.flags & (LEEK_OPTION_SUBSTRING | LEEK_OPTION_SUFFIX |
+	                          LEEK_OPTION_BEST | LEEK_OPTION_VARIANTS))
+		return;
+
+	leek.hashes.match_mask = mask;
+
+	for (size_t j = 0; j < leek.hashes.load_count; ++j) {
+		const struct leek_hash_entry *entry = &leek.hashes.load[j];
+		uint32_t value = ((uint32_t) entry->index << 16) | (entry->key >> 48) | mask;
+		unsigned int k = 0;
+
+		/* Several targets may share the same first word */
+		while (k < count && leek.hashes.match[k] != value)
+			k++;
+		if (k == count)
+			leek.hashes.match[count++] = value;
+	}
+
+	leek.hashes.match_count = count;
 }
 
 
@@ -327,7 +885,10 @@ int leek_hashes_stats(void)
 	len_min = leek.hashes.stats.len_min;
 	len_max = leek.hashes.stats.len_max;
 
-	if (len_min == len_max) {
+	if (leek.hashes.pattern_count)
+		printf("[+] Loaded %u valid patterns in range %u:%u.\n",
+		       leek.hashes.stats.valids, len_min, len_max);
+	else if (len_min == len_max) {
 		if (len_min == LEEK_ADDRESS_LEN)
 			printf("[+] Loaded %u valid target onion addresses.\n",
 			       leek.hashes.stats.valids);
@@ -339,6 +900,11 @@ int leek_hashes_stats(void)
 		printf("[+] Loaded %u valid prefixes in range %u:%u.\n",
 		       leek.hashes.stats.valids, len_min, len_max);
 
+	if (leek.hashes.second)
+		printf("[+] Loaded %u valid second words in range %u:%u.\n",
+		       leek.hashes.second->stats.valids, leek.hashes.second->stats.len_min,
+		       leek.hashes.second->stats.len_max);
+
 	if (leek.options.flags & LEEK_OPTION_VERBOSE) {
 		if (   leek.hashes.stats.invalids
 		    || leek.hashes.stats.duplicates
@@ -349,13 +915,49 @@ int leek_hashes_stats(void)
 		}
 	}
 
+	if (leek.hashes.fold_count && (leek.options.flags & LEEK_OPTION_VERBOSE)) {
+		uint64_t variants = 0;
+
+		for (unsigned int i = 0; i < LEEK_ADDRESS_LEN; ++i)
+			variants += leek.hashes.stats.variants[i];
+		printf("[+] Folding %u characters, loaded prefixes match %"PRIu64" variants.\n",
+		       leek.hashes.fold_count, variants);
+	}
+
 	/* Update min and max length based on the loaded dictionary */
 	leek.options.len_min = len_min;
 	leek.options.len_max = len_max;
 
+	/* Lookup masks depend on the minimum length */
+	leek_hashes_match_build();
+
+	/* Index kind depends on loaded lengths (loaded entries are released) */
+	ret = leek_hashes_build();
+	if (ret < 0)
+		goto out;
+
+	if (leek.options.flags & (LEEK_OPTION_VERBOSE | LEEK_OPTION_COMPACT)) {
+		printf("[+] Built %s index in %.1fms (%zu KB, %.2f bytes per prefix).\n",
+		       leek.hashes.automaton.delta ? "automaton" : leek.hashes.patterns ? "pattern"
+		       : leek.hashes.table ? "cuckoo table" : leek.hashes.packed ? "compact" : "sorted",
+		       leek.hashes.stats.index_time / 1000.,
+		       leek.hashes.stats.index_size / 1024,
+		       (double) leek.hashes.stats.index_size / leek.hashes.stats.valids);
+	}
+
+	if (leek.options.flags & LEEK_OPTION_VERBOSE) {
+		leek_region_report();
+		if (leek.hashes.filter.fingerprints)
+			printf("[+] Using a %u KB prefilter on %u characters.\n",
+			       leek.hashes.filter.array_length / 1024, leek.hashes.stats.len_min);
+	}
+
 	if (leek.options.flags & LEEK_OPTION_VERBOSE) {
 		printf("[+] Using %s implementation on %u worker threads.\n",
 		       leek.implementation->name, leek.options.threads);
+		if (leek.options.placement == LEEK_PLACEMENT_MIXED)
+			printf("[+] Using %s implementation on SMT siblings.\n",
+			       leek.sibling_implementation->name);
 	}
 
 	leek_stats_proba_update();
@@ -367,13 +969,235 @@ out:
 
 void leek_hashes_clean(void)
 {
-	for (unsigned int i = 0; i < LEEK_HASH_BUCKETS; ++i) {
-		if (leek.hashes.bucket[i].data)
-			free(leek.hashes.bucket[i].data);
+	free(leek.hashes.load);
+	leek_region_free(leek.hashes.offsets);
+	leek_region_free(leek.hashes.keys);
+	leek_region_free(leek.hashes.links);
+	leek_region_free(leek.hashes.table);
+	leek_region_free(leek.hashes.packed);
+	leek_filter_clean(&leek.hashes.filter);
+	leek_region_free(leek.hashes.patterns);
+	leek_region_free(leek.hashes.pattern_offsets);
+	leek_region_free(leek.hashes.pattern_routes);
+	leek_automaton_clean(&leek.hashes.automaton);
+	leek_hashes_replica_free(leek.hashes.second);
+}
+
+
+/* Copy of all lookup structures (second words included) */
+static struct leek_hashes *leek_hashes_dup(const struct leek_hashes *src)
+{
+	struct leek_hashes *hashes;
+
+	hashes = leek_region_alloc(sizeof(*hashes));
+	if (!hashes)
+		goto out;
+
+	/* Statistics and filter counters stay global (see leek_result_lookup) */
+	memcpy(hashes, src, sizeof(*hashes));
+	hashes->offsets = leek_region_dup(src->offsets);
+	hashes->keys = leek_region_dup(src->keys);
+	hashes->links = leek_region_dup(src->links);
+	hashes->packed = leek_region_dup(src->packed);
+	hashes->table = leek_region_dup(src->table);
+	hashes->filter.fingerprints = leek_region_dup(src->filter.fingerprints);
+	hashes->patterns = leek_region_dup(src->patterns);
+	hashes->pattern_offsets = leek_region_dup(src->pattern_offsets);
+	hashes->pattern_routes = leek_region_dup(src->pattern_routes);
+	hashes->automaton.delta = leek_region_dup(src->automaton.delta);
+	hashes->automaton.output = leek_region_dup(src->automaton.output);
+	hashes->automaton.grams = leek_region_dup(src->automaton.grams);
+	hashes->second = src->second ? leek_hashes_dup(src->second) : NULL;
+
+	if (   (src->offsets && !hashes->offsets)
+	    || (src->keys && !hashes->keys)
+	    || (src->links && !hashes->links)
+	    || (src->packed && !hashes->packed)
+	    || (src->table && !hashes->table)
+	    || (src->filter.fingerprints && !hashes->filter.fingerprints)
+	    || (src->patterns && !hashes->patterns)
+	    || (src->pattern_offsets && !hashes->pattern_offsets)
+	    || (src->pattern_routes && !hashes->pattern_routes)
+	    || (src->automaton.delta && !hashes->automaton.delta)
+	    || (src->automaton.output && !hashes->automaton.output)
+	    || (src->automaton.grams && !hashes->automaton.grams)
+	    || (src->second && !hashes->second)) {
+		leek_hashes_replica_free(hashes);
+		hashes = NULL;
+	}
+
+out:
+	return hashes;
+}
+
+
+struct leek_hashes *leek_hashes_replicate(void)
+{
+	return leek_hashes_dup(&leek.hashes);
+}
+
+
+void leek_hashes_replica_free(struct leek_hashes *hashes)
+{
+	if (hashes) {
+		leek_region_free(hashes->offsets);
+		leek_region_free(hashes->keys);
+		leek_region_free(hashes->links);
+		leek_region_free(hashes->packed);
+		leek_region_free(hashes->table);
+		leek_region_free(hashes->filter.fingerprints);
+		leek_region_free(hashes->patterns);
+		leek_region_free(hashes->pattern_offsets);
+		leek_region_free(hashes->pattern_routes);
+		leek_region_free(hashes->automaton.delta);
+		leek_region_free(hashes->automaton.output);
+		leek_region_free(hashes->automaton.grams);
+		leek_hashes_replica_free(hashes->second);
+		leek_region_free(hashes);
 	}
 }
 
 
+/* Symbol number of a base32 character (or -1) */
+static int leek_base32_symbol(char c)
+{
+	const char *ptr = (c) ? strchr(LEEK_BASE32_ALPHABET, c) : NULL;
+
+	return ptr ? ptr - LEEK_BASE32_ALPHABET : -1;
+}
+
+
+/* Folding table from pairs of characters, the first one is folded on the
+ * second one (e.g. "3e4a" matches 'e' or '3', then 'a' or '4') */
+static int leek_hashes_fold_init(const char *pairs)
+{
+	size_t length = strlen(pairs);
+	int ret = -1;
+
+	for (unsigned int s = 0; s < LEEK_BASE32_SYMBOLS; ++s)
+		leek.hashes.fold[s] = s;
+
+	if (length % 2)
+		goto error;
+
+	for (size_t i = 0; i < length; i += 2) {
+		int from = leek_base32_symbol(pairs[i]);
+		int to = leek_base32_symbol(pairs[i + 1]);
+
+		/* Canonical symbols are never folded themselves */
+		if (from < 0 || to < 0 || from == to || leek.hashes.fold[to] != to)
+			goto error;
+
+		for (unsigned int s = 0; s < LEEK_BASE32_SYMBOLS; ++s) {
+			if (leek.hashes.fold[s] == from)
+				leek.hashes.fold[s] = to;
+		}
+	}
+
+	for (unsigned int s = 0; s < LEEK_BASE32_SYMBOLS; ++s)
+		leek.hashes.fold_count += (leek.hashes.fold[s] != s);
+
+	for (unsigned int pair = 0; pair < ARRAY_SIZE(leek.hashes.fold_pairs); ++pair) {
+		leek.hashes.fold_pairs[pair] = (leek.hashes.fold[pair / LEEK_BASE32_SYMBOLS] * LEEK_BASE32_SYMBOLS)
+		                             | leek.hashes.fold[pair % LEEK_BASE32_SYMBOLS];
+	}
+
+	ret = 0;
+out:
+	return ret;
+
+error:
+	fprintf(stderr, "error: invalid variants '%s' (pairs of distinct base32 characters).\n",
+	        pairs);
+	goto out;
+}
+
+
+/* Each loaded prefix stands for all of its variants (for probabilities) */
+static void leek_hashes_fold_count(void)
+{
+	unsigned int weights[LEEK_BASE32_SYMBOLS] = { 0 };
+
+	for (unsigned int s = 0; s < LEEK_BASE32_SYMBOLS; ++s)
+		weights[leek.hashes.fold[s]]++;
+
+	for (size_t j = 0; j < leek.hashes.load_count; ++j) {
+		const struct leek_hash_entry *entry = &leek.hashes.load[j];
+		unsigned __int128 bits = ((unsigned __int128) entry->index << 64) | entry->key;
+		uint64_t count = 1;
+
+		for (unsigned int i = 0; i < entry->length; ++i) {
+			unsigned int shift = 8 * LEEK_RAWADDR_LEN - LEEK_RAWADDR_CHAR_BITS * (i + 1);
+
+			count *= weights[(bits >> shift) & (LEEK_BASE32_SYMBOLS - 1)];
+		}
+
+		leek.hashes.stats.variants[entry->length - 1] += count;
+	}
+}
+
+
+/* Second words are loaded first, with the usual functions, then moved
+ * to their own lookup structures (see --second and leek_hashes_second) */
+static int leek_hashes_second_load(void)
+{
+	unsigned int len_min = leek.options.len_min;
+	unsigned int len_max = leek.options.len_max;
+	struct leek_hashes *second;
+	int ret;
+
+	if (leek.options.flags & LEEK_OPTION_VARIANTS) {
+		ret = leek_hashes_fold_init(leek.options.variants);
+		if (ret < 0)
+			goto out;
+	}
+
+	/* Length filters only apply to first words */
+	leek.options.len_min = LEEK_PREFIX_LENGTH_MIN;
+	leek.options.len_max = LEEK_PREFIX_LENGTH_MAX;
+	ret = leek_hashes_readfile(leek.options.second_file);
+	leek.options.len_min = len_min;
+	leek.options.len_max = len_max;
+	if (ret < 0)
+		goto out;
+
+	leek_hashes_load_sort();
+	if (!leek.hashes.stats.valids) {
+		fprintf(stderr, "error: no valid second word was loaded, please check your parameters.\n");
+		ret = -1;
+		goto out;
+	}
+
+	if (leek.hashes.fold_count)
+		leek_hashes_fold_count();
+
+	for (size_t j = 0; j < leek.hashes.load_count; ++j) {
+		uint16_t index = htobe16(leek.hashes.load[j].index);
+
+		leek.hashes.bitmap[index / 64] |= (1ULL << (index % 64));
+	}
+
+	ret = leek_hashes_index_build();
+	if (ret < 0)
+		goto out;
+
+	second = leek_region_alloc(sizeof(*second));
+	if (!second) {
+		fprintf(stderr, "error: malloc: %s\n", strerror(errno));
+		ret = -1;
+		goto out;
+	}
+
+	free(leek.hashes.load);
+	leek.hashes.load = NULL;
+	memcpy(second, &leek.hashes, sizeof(*second));
+	memset(&leek.hashes, 0, sizeof(leek.hashes));
+	leek.hashes.second = second;
+out:
+	return ret;
+}
+
+
 int leek_hashes_load(void)
 {
 	int ret;
@@ -381,6 +1205,18 @@ int leek_hashes_load(void)
 	/* Make sure everything is zeroed appropriately. */
 	memset(&leek.hashes, 0, sizeof(leek.hashes));
 
+	if (leek.options.flags & LEEK_OPTION_SECOND) {
+		ret = leek_hashes_second_load();
+		if (ret < 0)
+			goto out;
+	}
+
+	if (leek.options.flags & LEEK_OPTION_VARIANTS) {
+		ret = leek_hashes_fold_init(leek.options.variants);
+		if (ret < 0)
+			goto out;
+	}
+
 	if (leek.options.flags & LEEK_OPTION_SINGLE)
 		ret = leek_hash_add(leek.options.prefix_single);
 	else
@@ -389,7 +1225,12 @@ int leek_hashes_load(void)
 	if (ret < 0)
 		goto out;
 
-	leek_hashes_sort();
+	/* Index is built along statistics */
+	leek_hashes_load_sort();
+	leek.hashes.stats.valids += leek.hashes.pattern_count;
+
+	if (leek.hashes.fold_count)
+		leek_hashes_fold_count();
 
 out:
 	return ret;
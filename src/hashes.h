@@ -1,12 +1,42 @@
 #ifndef __LEEK_HASHES_H
 # define __LEEK_HASHES_H
+# include <endian.h>
+# include <stddef.h>
 # include <stdint.h>
+# include <string.h>
 
+# include "automaton.h"
+# include "filter.h"
+# include "pattern.h"
 # include "helper.h"
 
 # define LEEK_BASE32_ALPHABET   "abcdefghijklmnopqrstuvwxyz234567"
+# define LEEK_BASE32_SYMBOLS    32
 # define LEEK_HASH_BUCKETS      (1 << 16)
-# define LEEK_HASH_BUCKETS_INC  8
+# define LEEK_HASH_BITMAP_SIZE  (LEEK_HASH_BUCKETS / 64)
+# define LEEK_HASH_MATCH_MAX    32
+# define LEEK_HASH_LOAD_INC     4096
+
+/* Directory width in bits (see leek_hashes_index_build) */
+# define LEEK_HASH_INDEX_MIN    16
+# define LEEK_HASH_INDEX_MAX    24
+# define LEEK_HASH_SLOT_KEYS    8  /* one cache line of keys */
+
+/* Entry links: prefix length and distance to the parent entry */
+# define LEEK_HASH_LINK_BITS    5
+# define LEEK_HASH_LINK_LENGTH(x)  ((x) & ((1 << LEEK_HASH_LINK_BITS) - 1))
+# define LEEK_HASH_LINK_PARENT(x)  ((x) >> LEEK_HASH_LINK_BITS)
+
+/* Compact entries are read with a single unaligned 64 bits load */
+# define LEEK_HASH_PACKED_MAX   57
+
+/* Cuckoo table for exact length dictionaries (see leek_hashes_table_build) */
+# define LEEK_HASH_TABLE_WAYS   6  /* keys per bucket (one cache line) */
+# define LEEK_HASH_TABLE_LOAD   90 /* initial load factor (percents) */
+# define LEEK_HASH_TABLE_KICKS  512
+
+/* Large dictionaries populate all buckets, a filter is checked first */
+# define LEEK_HASH_FILTER_MIN   (1 << 20)
 
 /* Describes a raw onion address structure */
 union leek_rawaddr {
@@ -22,26 +52,94 @@ union leek_rawaddr {
 	} __packed;
 };
 
-struct leek_hash_bucket {
-	unsigned int cur_count;
-	unsigned int max_count;
-	unsigned int flags;
-	uint64_t *data;
+/* Bucket of the cuckoo table, unused ways are after 'count' */
+struct leek_hash_table_bucket {
+	uint64_t keys[LEEK_HASH_TABLE_WAYS];
+	uint16_t index[LEEK_HASH_TABLE_WAYS];
+	uint16_t count;
+	uint16_t reserved;
 };
 
-enum {
-	LEEK_HASH_BUCKET_SORTED = (1 <<  0),
-};
+/* Prefix as read from input (only used while loading) */
+struct leek_hash_entry {
+	uint64_t key;          /* address suffix, bits after the prefix are cleared */
+	uint16_t index;        /* address index (big endian, host order) */
+	uint8_t length;        /* prefix length (in characters) */
+} __packed;
 
 struct leek_hashes {
-	/* All buckets of loaded hashes */
-	struct leek_hash_bucket bucket[LEEK_HASH_BUCKETS];
+	/* Occupancy of all buckets (one bit per bucket index, 8KB) */
+	uint64_t bitmap[LEEK_HASH_BITMAP_SIZE];
+
+	/* Loaded hashes as a compressed sparse row index (see hashes.c):
+	 *  - slot 's' holds keys from offsets[s] to offsets[s + 1],
+	 *  - slots are the first 'index_bits' bits of the address,
+	 *  - keys are sorted in address order (big endian suffix). */
+	unsigned int index_bits;
+	uint32_t *offsets;
+	uint64_t *keys;
+	uint32_t *links;
+
+	/* Compact index (--compact) replaces keys and links with fixed width
+	 * entries: address bits after the slot, then length and parent link
+	 * (the directory stands for the high bits, like in Elias-Fano) */
+	uint8_t *packed;
+	unsigned int packed_bits;
+	unsigned int packed_key_bits;
+	unsigned int packed_length_bits;
+	unsigned int packed_parent_bits;
+
+	/* When all prefixes have the same length, they are stored in a two-choice
+	 * cuckoo table instead (any key is in one of its two buckets) */
+	struct leek_hash_table_bucket *table;
+	uint32_t table_buckets;
+	unsigned int table_length;
+
+	/* Filter on addresses cut to the shortest prefix (large dictionaries) */
+	struct leek_filter filter;
+
+	/* Patterns (--pattern) replace the index: addresses with bucket index 'i'
+	 * (host order) may match patterns pattern_routes[pattern_offsets[i]]
+	 * up to pattern_routes[pattern_offsets[i + 1]] */
+	struct leek_pattern *patterns;
+	uint32_t *pattern_offsets;
+	uint32_t *pattern_routes;
+	unsigned int pattern_count;
+	unsigned int pattern_max;
+
+	/* Second words, found right after the loaded prefixes (see --second),
+	 * with their own sorted index */
+	struct leek_hashes *second;
+
+	/* Substring and suffix modes replace the index with an automaton
+	 * run over all addresses (the bitmap is full) */
+	struct leek_automaton automaton;
+
+	/* Look-alike symbols are folded on a single one, in loaded prefixes and
+	 * in addresses before any lookup (see --variants and leek_hashes_fold) */
+	uint8_t fold[LEEK_BASE32_SYMBOLS];
+	uint16_t fold_pairs[LEEK_BASE32_SYMBOLS * LEEK_BASE32_SYMBOLS];
+	unsigned int fold_count;
+
+	/* Prefixes being loaded (freed once the index is built) */
+	struct leek_hash_entry *load;
+	size_t load_count;
+	size_t load_max;
+
+	/* Small target sets: first address word of each target (host order),
+	 * compared after 'match_mask' is applied (see leek_hashes_match_build) */
+	uint32_t match[LEEK_HASH_MATCH_MAX];
+	uint32_t match_mask;
+	unsigned int match_count;
 
 	/* Statistics on loaded hashes */
 	struct {
 		/* Number of loaded items by length */
 		unsigned int length[LEEK_ADDRESS_LEN];
 
+		/* Number of prefixes matched by loaded items by length (--variants) */
+		uint64_t variants[LEEK_ADDRESS_LEN];
+
 		unsigned int duplicates;
 		unsigned int filtered;
 		unsigned int invalids;
@@ -49,6 +147,10 @@ struct leek_hashes {
 
 		unsigned int len_min;
 		unsigned int len_max;
+
+		/* Index build time (in micro-seconds) and size (in bytes) */
+		uint64_t index_time;
+		size_t index_size;
 	} stats;
 };
 
@@ -64,24 +166,276 @@ void leek_hashes_clean(void);
 /* Check loaded hashes and build initial statistics */
 int leek_hashes_stats(void);
 
+/* Copy of all lookup structures (memory is local to the calling thread) */
+struct leek_hashes *leek_hashes_replicate(void);
+void leek_hashes_replica_free(struct leek_hashes *hashes);
+
 
-/* We need this inlined in several files for performance reasons */
-static inline int leek_bucket_lookup(const struct leek_hash_bucket *bucket, uint64_t val)
+/* Key bits compared for a prefix of 'length' characters (first 16 bits of
+ * the address are the bucket index and are not part of the key) */
+static inline uint64_t leek_hash_key_mask(unsigned int length)
 {
-	int max = bucket->cur_count - 1;
-	int min = 0;
-	int piv;
+	return ~0ULL << (64 - (5 * length - 16));
+}
+
+/* Folds the first 'length' symbols of an address (host order) on their
+ * canonical symbol, so that all variants of a prefix share a single entry */
+static inline void leek_hashes_fold(const struct leek_hashes *hashes, unsigned int length,
+                                    uint16_t *index, uint64_t *key)
+{
+	unsigned __int128 bits = ((unsigned __int128) *index << 64) | *key;
+
+	/* Symbols are folded two by two (the last one may be folded for nothing) */
+	for (unsigned int i = 0; i < length; i += 2) {
+		unsigned int shift = 8 * LEEK_RAWADDR_LEN - LEEK_RAWADDR_CHAR_BITS * (i + 2);
+		unsigned int pair = (bits >> shift) & (LEEK_BASE32_SYMBOLS * LEEK_BASE32_SYMBOLS - 1);
+
+		bits ^= (unsigned __int128) (hashes->fold_pairs[pair] ^ pair) << shift;
+	}
+
+	*index = bits >> 64;
+	*key = bits;
+}
+
+/* Directory slot of an address (index holds its first 2 bytes, big endian) */
+static inline uint32_t leek_hashes_slot(const struct leek_hashes *hashes,
+                                        uint16_t index, uint64_t key)
+{
+	uint64_t head = ((uint64_t) index << 48) | (key >> 16);
+
+	return head >> (64 - hashes->index_bits);
+}
+
+/* Raw compact entry 'j' (see leek_hashes_pack) */
+static inline uint64_t leek_hashes_packed(const struct leek_hashes *hashes, uint32_t j)
+{
+	uint64_t bit = (uint64_t) j * hashes->packed_bits;
+	uint64_t word;
+
+	memcpy(&word, &hashes->packed[bit / 8], sizeof(word));
+	return (le64toh(word) >> (bit % 8)) & ((1ULL << hashes->packed_bits) - 1);
+}
+
+/* Key of entry 'j' in 'slot' (rebuilt from slot bits for compact entries) */
+static inline uint64_t leek_hashes_key(const struct leek_hashes *hashes,
+                                       uint32_t slot, uint32_t j)
+{
+	uint64_t low;
+
+	if (!hashes->packed)
+		return hashes->keys[j];
+
+	low = leek_hashes_packed(hashes, j)
+	    >> (hashes->packed_length_bits + hashes->packed_parent_bits);
+
+	return ((uint64_t) slot << (79 - hashes->index_bits) << 1)
+	     | (low << (80 - LEEK_RAWADDR_CHAR_BITS * hashes->stats.len_max));
+}
+
+/* Link of entry 'j' (see LEEK_HASH_LINK_LENGTH and LEEK_HASH_LINK_PARENT) */
+static inline uint32_t leek_hashes_link(const struct leek_hashes *hashes, uint32_t j)
+{
+	uint64_t entry;
+	uint32_t length;
+	uint32_t parent;
+
+	if (!hashes->packed)
+		return hashes->links[j];
+
+	entry = leek_hashes_packed(hashes, j);
+	parent = entry & ((1ULL << hashes->packed_parent_bits) - 1);
+	length = (entry >> hashes->packed_parent_bits) & ((1ULL << hashes->packed_length_bits) - 1);
+
+	return (parent << LEEK_HASH_LINK_BITS) | (hashes->stats.len_min + length);
+}
+
+/* Position of the first entry of 'slot' greater than 'key' (predecessor search) */
+static inline uint32_t leek_hashes_successor(const struct leek_hashes *hashes,
+                                             uint32_t slot, uint64_t key)
+{
+	uint32_t min = hashes->offsets[slot];
+	uint32_t max = hashes->offsets[slot + 1];
+	uint32_t piv;
 
 	while (min < max) {
 		piv = (min + max) / 2;
 
-		if (bucket->data[piv] < val)
+		if (leek_hashes_key(hashes, slot, piv) <= key)
 			min = piv + 1;
 		else
 			max = piv;
 	}
 
-	return (bucket->data[max] == val);
+	return min;
+}
+
+/* Length of the longest entry that is a prefix of 'key' (up to 'length_max'),
+ * given its successor. Any matching entry is also a prefix of the predecessor,
+ * parents are walked from the longest one (see hashes.c) */
+static inline unsigned int leek_hashes_prefix(const struct leek_hashes *hashes,
+                                              uint32_t slot, uint64_t key,
+                                              uint32_t next, unsigned int length_max)
+{
+	unsigned int length;
+	uint32_t link;
+	uint32_t piv;
+
+	if (next == hashes->offsets[slot])
+		return 0;
+
+	piv = next - 1;
+	do {
+		link = leek_hashes_link(hashes, piv);
+		length = LEEK_HASH_LINK_LENGTH(link);
+
+		if (   length <= length_max
+		    && (key & leek_hash_key_mask(length)) == leek_hashes_key(hashes, slot, piv))
+			return length;
+
+		piv -= LEEK_HASH_LINK_PARENT(link);
+	} while (LEEK_HASH_LINK_PARENT(link));
+
+	return 0;
+}
+
+/* We need this inlined in several files for performance reasons
+ * Returns the length of the longest entry that is a prefix of 'key' (or 0) */
+static inline unsigned int leek_hashes_search(const struct leek_hashes *hashes,
+                                              uint32_t slot, uint64_t key)
+{
+	return leek_hashes_prefix(hashes, slot, key, leek_hashes_successor(hashes, slot, key),
+	                          LEEK_ADDRESS_LEN);
+}
+
+/* Length of the first word followed by the longest second word (see --second)
+ * The address is shifted by the first word, the second one must fit in what
+ * is left (shifted in bits are not part of the address). */
+static inline unsigned int leek_hashes_second(const struct leek_hashes *second,
+                                              uint16_t index, uint64_t key,
+                                              unsigned int length)
+{
+	unsigned __int128 bits = ((unsigned __int128) index << 64) | key;
+	unsigned int left = LEEK_ADDRESS_LEN - length;
+	uint16_t index_be;
+	uint32_t slot;
+	uint32_t next;
+	unsigned int found;
+
+	if (left < second->stats.len_min)
+		return 0;
+
+	bits <<= LEEK_RAWADDR_CHAR_BITS * length;
+	index = bits >> 64;
+	key = bits;
+
+	if (second->fold_count)
+		leek_hashes_fold(second, left, &index, &key);
+
+	/* Bitmap is indexed like raw addresses (big endian) */
+	index_be = htobe16(index);
+	if (!((second->bitmap[index_be / 64] >> (index_be % 64)) & 1))
+		return 0;
+
+	slot = leek_hashes_slot(second, index, key);
+	next = leek_hashes_successor(second, slot, key);
+	found = leek_hashes_prefix(second, slot, key, next, left);
+
+	return found ? length + found : 0;
+}
+
+/* Characters shared by 'key' and the closest entries of its slot (see --best)
+ * Without any full match, the longest common prefix with any entry is found
+ * either on the predecessor or on the successor of the key.
+ * Addresses always share their index with some entry (bitmap probe). */
+static inline unsigned int leek_hashes_common(const struct leek_hashes *hashes,
+                                              uint32_t slot, uint64_t key,
+                                              uint32_t next)
+{
+	unsigned int common = 16 / LEEK_RAWADDR_CHAR_BITS;
+	uint32_t first = hashes->offsets[slot];
+	uint32_t last = hashes->offsets[slot + 1];
+
+	for (uint32_t j = (next > first) ? next - 1 : next; j <= next && j < last; ++j) {
+		uint64_t diff = key ^ leek_hashes_key(hashes, slot, j);
+		unsigned int bits = 16 + (diff ? __builtin_clzll(diff) : 64);
+		unsigned int length = LEEK_HASH_LINK_LENGTH(leek_hashes_link(hashes, j));
+		unsigned int chars = bits / LEEK_RAWADDR_CHAR_BITS;
+
+		chars = (chars < length) ? chars : length;
+		common = (chars > common) ? chars : common;
+	}
+
+	return common;
+}
+
+
+/* Filter key of an address (key is cut to the shortest prefix) */
+static inline uint64_t leek_hashes_filter_key(uint16_t index, uint64_t key)
+{
+	return key ^ (index * 0x9E3779B97F4A7C15ULL);
+}
+
+/* Both bucket candidates of a key in the cuckoo table */
+static inline uint64_t leek_hashes_table_hash(uint16_t index, uint64_t key)
+{
+	uint64_t hash = key ^ (index * 0x9E3779B97F4A7C15ULL);
+
+	/* Loaded prefixes are far from random, mix all bits (murmur3 finalizer) */
+	hash ^= hash >> 33;
+	hash *= 0xFF51AFD7ED558CCDULL;
+	hash ^= hash >> 33;
+	hash *= 0xC4CEB9FE1A85EC53ULL;
+	hash ^= hash >> 33;
+
+	return hash;
+}
+
+/* Maps one half of a hash to a bucket (without any division) */
+static inline uint32_t leek_hashes_table_bucket(const struct leek_hashes *hashes,
+                                                uint32_t half)
+{
+	return ((uint64_t) half * hashes->table_buckets) >> 32;
+}
+
+/* Returns the prefix length when key is in the cuckoo table (or 0) */
+static inline unsigned int leek_hashes_table_search(const struct leek_hashes *hashes,
+                                                    uint16_t index, uint64_t key)
+{
+	uint64_t hash;
+	const struct leek_hash_table_bucket *b1;
+	const struct leek_hash_table_bucket *b2;
+	unsigned int found = 0;
+
+	key &= leek_hash_key_mask(hashes->table_length);
+	hash = leek_hashes_table_hash(index, key);
+	b1 = &hashes->table[leek_hashes_table_bucket(hashes, hash)];
+	b2 = &hashes->table[leek_hashes_table_bucket(hashes, hash >> 32)];
+
+	/* All ways of both buckets are checked without branches */
+	for (unsigned int j = 0; j < LEEK_HASH_TABLE_WAYS; ++j) {
+		found |= (j < b1->count) & (b1->keys[j] == key) & (b1->index[j] == index);
+		found |= (j < b2->count) & (b2->keys[j] == key) & (b2->index[j] == index);
+	}
+
+	return found ? hashes->table_length : 0;
+}
+
+/* Returns the longest pattern length matching an address (or 0) */
+static inline unsigned int leek_hashes_pattern_search(const struct leek_hashes *hashes,
+                                                      uint16_t index, uint64_t key)
+{
+	uint32_t first = hashes->pattern_offsets[index];
+	uint32_t last = hashes->pattern_offsets[index + 1];
+	unsigned int length = 0;
+
+	for (uint32_t j = first; j < last; ++j) {
+		const struct leek_pattern *pattern = &hashes->patterns[hashes->pattern_routes[j]];
+		unsigned int found = leek_pattern_match(pattern, index, key);
+
+		length = (found > length) ? found : length;
+	}
+
+	return length;
 }
 
 #endif /* !__LEEK_HASHES_H */
@@ -1,7 +1,9 @@
 #include <errno.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <unistd.h>
 
@@ -13,6 +15,21 @@
 /* Locks provided to OpenSSL */
 static pthread_mutex_t *leek_openssl_locks;
 
+/* Bytes mapped by leek_region_alloc (for leek_region_report) */
+static struct {
+	size_t hugetlb;     /* On explicit huge pages */
+	size_t advised;     /* Advised for transparent huge pages */
+	size_t locked;      /* Locked in memory (--mlock) */
+	size_t total;
+} leek_regions;
+
+/* Header in front of each region (keeps a cache line alignment) */
+struct leek_region {
+	size_t length;      /* Mapping length */
+	size_t size;        /* Requested size */
+	uint8_t padding[LEEK_CACHELINE_SZ - 2 * sizeof(size_t)];
+};
+
 
 int leek_result_dir_init(void)
 {
@@ -84,6 +101,157 @@ out:
 }
 
 
+/* Anonymous mapping aligned on a huge page (so it can be fully backed) */
+static uint8_t *leek_region_map_aligned(size_t length)
+{
+	uint8_t *base;
+	uint8_t *aligned;
+	size_t head;
+
+	base = mmap(NULL, length + LEEK_HUGEPAGE_SZ, PROT_READ | PROT_WRITE,
+	            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (base == MAP_FAILED)
+		return NULL;
+
+	aligned = (uint8_t *) (((uintptr_t) base + LEEK_HUGEPAGE_SZ - 1) & ~((uintptr_t) LEEK_HUGEPAGE_SZ - 1));
+	head = aligned - base;
+
+	if (head)
+		munmap(base, head);
+	munmap(aligned + length, LEEK_HUGEPAGE_SZ - head);
+
+	return aligned;
+}
+
+
+void *leek_region_alloc(size_t size)
+{
+	size_t page = sysconf(_SC_PAGESIZE);
+	size_t length = size + sizeof(struct leek_region);
+	struct leek_region *region;
+	uint8_t *base = MAP_FAILED;
+
+	length = (length + page - 1) & ~(page - 1);
+
+	/* Explicit huge pages are prefaulted (and fail when none are reserved) */
+	if (length >= LEEK_HUGEPAGE_SZ) {
+		length = (length + LEEK_HUGEPAGE_SZ - 1) & ~((size_t) LEEK_HUGEPAGE_SZ - 1);
+		base = mmap(NULL, length, PROT_READ | PROT_WRITE,
+		            MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_POPULATE, -1, 0);
+		if (base != MAP_FAILED)
+			leek_regions.hugetlb += length;
+	}
+
+	if (base == MAP_FAILED) {
+		if (length >= LEEK_HUGEPAGE_SZ) {
+			base = leek_region_map_aligned(length);
+			if (base && !madvise(base, length, MADV_HUGEPAGE))
+				leek_regions.advised += length;
+		}
+		else {
+			base = mmap(NULL, length, PROT_READ | PROT_WRITE,
+			            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+			if (base == MAP_FAILED)
+				base = NULL;
+		}
+
+		if (!base) {
+			fprintf(stderr, "error: mmap: %s\n", strerror(errno));
+			return NULL;
+		}
+
+		/* Fault pages now rather than in workers hot path */
+		for (size_t offset = 0; offset < length; offset += page)
+			((volatile uint8_t *) base)[offset] = 0;
+	}
+
+	if (leek.options.flags & LEEK_OPTION_MLOCK) {
+		if (mlock(base, length) < 0)
+			fprintf(stderr, "warning: mlock: %s\n", strerror(errno));
+		else
+			leek_regions.locked += length;
+	}
+
+	leek_regions.total += length;
+
+	region = (struct leek_region *) base;
+	region->length = length;
+	region->size = size;
+	return region + 1;
+}
+
+
+void *leek_region_dup(const void *ptr)
+{
+	const struct leek_region *region = ptr;
+	void *copy;
+
+	if (!ptr)
+		return NULL;
+
+	region--;
+	copy = leek_region_alloc(region->size);
+	if (copy)
+		memcpy(copy, ptr, region->size);
+
+	return copy;
+}
+
+
+void leek_region_free(void *ptr)
+{
+	struct leek_region *region = ptr;
+
+	if (ptr) {
+		region--;
+		munmap(region, region->length);
+	}
+}
+
+
+/* Transparent huge pages are not guaranteed, kernel tells how many we got */
+static size_t leek_region_thp_size(void)
+{
+	char line[128];
+	size_t size = 0;
+	FILE *fp;
+
+	fp = fopen("/proc/self/smaps_rollup", "r");
+	if (!fp)
+		return 0;
+
+	while (fgets(line, sizeof(line), fp)) {
+		if (sscanf(line, "AnonHugePages: %zu kB", &size) == 1)
+			break;
+	}
+	fclose(fp);
+
+	return size * 1024;
+}
+
+
+void leek_region_report(void)
+{
+	size_t thp;
+
+	if (leek_regions.hugetlb)
+		printf("[+] Lookup structures use %zu KB of huge pages.\n",
+		       leek_regions.hugetlb / 1024);
+	else if (leek_regions.advised) {
+		thp = leek_region_thp_size();
+		printf("[+] Lookup structures use %zu KB of transparent huge pages (%zu KB advised).\n",
+		       thp / 1024, leek_regions.advised / 1024);
+	}
+	else
+		printf("[+] Lookup structures do not use huge pages (%zu KB).\n",
+		       leek_regions.total / 1024);
+
+	if (leek_regions.locked)
+		printf("[+] Locked %zu KB of lookup structures in memory.\n",
+		       leek_regions.locked / 1024);
+}
+
+
 void leek_openssl_exit(void)
 {
 	if (leek_openssl_locks) {
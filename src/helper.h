@@ -1,11 +1,13 @@
 #ifndef __LEAK_HELPER_H
 # define __LEAK_HELPER_H
 
+# include <stddef.h>
 # include <openssl/opensslv.h>
 
 # define LEEK_ADDRESS_LEN              16u
 # define LEEK_RAWADDR_LEN              10u
 # define LEEK_CACHELINE_SZ             64u /* bytes */
+# define LEEK_HUGEPAGE_SZ              (2u << 20) /* bytes */
 
 /* Number of bits per base32 character */
 # define LEEK_RAWADDR_CHAR_BITS        5u
@@ -23,6 +25,12 @@
 # define __packed                      __attribute__((packed))
 # define __flatten                     __attribute__((flatten))
 # define __hot                         __attribute__((hot))
+# ifndef __cold
+#  define __cold                       __attribute__((cold))
+# endif
+# ifndef __always_inline
+#  define __always_inline              inline __attribute__((always_inline))
+# endif
 
 /* Help compiler generating more optimized code for some expected branches */
 # define likely(x)                     __builtin_expect(!!(x), 1)
@@ -40,6 +48,17 @@
 #  define OPENSSL_VERSION_3_0    0x30000000L
 # endif
 
+/* Zeroed memory for lookup structures (cache line aligned), on huge pages
+ * when possible, prefaulted and locked in memory with --mlock */
+void *leek_region_alloc(size_t size);
+void leek_region_free(void *ptr);
+
+/* Copy of a region (allocated by the calling thread, see --numa) */
+void *leek_region_dup(const void *ptr);
+
+/* Tell whether lookup structures got huge pages */
+void leek_region_report(void);
+
 /* Create result directory if needed */
 int leek_result_dir_init(void);
 
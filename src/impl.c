@@ -9,6 +9,7 @@
 const struct leek_implementation *leek_implementations[] = {
 	&leek_impl_openssl, /* OpenSSL implementation */
 	&leek_impl_uint,    /* uint32_t implementation */
+	&leek_impl_vecext,  /* compiler vector extensions implementation */
 #ifdef HAVE_SIMD_SSSE3
 	&leek_impl_ssse3,   /* SSSE3 implementation */
 #endif
@@ -17,6 +18,23 @@ const struct leek_implementation *leek_implementations[] = {
 #endif
 #ifdef HAVE_SIMD_AVX512
 	&leek_impl_avx512,  /* AVX512 implementation */
+#endif
+#ifdef HAVE_SIMD_AVX512VL
+	&leek_impl_avx512vl, /* AVX512 implementation (256b registers) */
+#endif
+#ifdef HAVE_SIMD_SHANI
+	&leek_impl_shani,   /* SHA-NI implementation */
+#endif
+	/* Interleaved variants are listed last so they never win a tie */
+	&leek_impl_uintx4,  /* uint32_t implementation (4 streams) */
+#ifdef HAVE_SIMD_SSSE3
+	&leek_impl_ssse3x2, /* SSSE3 implementation (2 streams) */
+#endif
+#ifdef HAVE_SIMD_AVX2
+	&leek_impl_avx2x2,  /* AVX2 implementation (2 streams) */
+#endif
+#ifdef HAVE_SIMD_AVX512
+	&leek_impl_avx512x2, /* AVX512 implementation (2 streams) */
 #endif
 	NULL,
 };
@@ -44,7 +62,7 @@ static void leek_implementation_select_best(void)
 }
 
 
-int leek_implementation_select(const char *name)
+static const struct leek_implementation *leek_implementation_find(const char *name)
 {
 	const struct leek_implementation *selected = NULL;
 
@@ -56,11 +74,41 @@ int leek_implementation_select(const char *name)
 	if (selected) {
 		if (!selected->available())
 			fprintf(stderr, "[!] Selected %s implementation (not supported by your CPU).\n", selected->name);
-		leek.implementation = selected;
 	}
 	else
 		fprintf(stderr, "error: unable to find matching implementation.\n");
 
+	return selected;
+}
+
+
+int leek_implementation_select(const char *name)
+{
+	const struct leek_implementation *selected;
+
+	selected = leek_implementation_find(name);
+	if (selected)
+		leek.implementation = selected;
+
+	return (selected) ? 0 : -1;
+}
+
+
+int leek_implementation_sibling_select(const char *name)
+{
+	const struct leek_implementation *selected = &leek_impl_uint;
+
+	if (name)
+		selected = leek_implementation_find(name);
+#ifdef HAVE_SIMD_SHANI
+	/* SHA extensions do not compete with vector units */
+	else if (leek_impl_shani.available())
+		selected = &leek_impl_shani;
+#endif
+
+	if (selected)
+		leek.sibling_implementation = selected;
+
 	return (selected) ? 0 : -1;
 }
 
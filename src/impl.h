@@ -26,6 +26,12 @@ struct leek_implementation {
 
 	/* Perform SHA1 full exhaust for the current RSA key pair */
 	int (*exhaust) (struct leek_rsa_item *item, struct leek_worker *wk);
+
+	/* Names of exhaust kernel variants (NULL terminated, may be NULL) */
+	const char *const *variants;
+
+	/* Select the exhaust kernel variant used for new items (see tune.c) */
+	void (*variant_set) (unsigned int variant);
 };
 
 
@@ -35,13 +41,23 @@ void leek_implementations_init(void);
 /* Select implementation by name */
 int leek_implementation_select(const char *name);
 
+/* Select implementation used on SMT siblings (default when name is NULL) */
+int leek_implementation_sibling_select(const char *name);
+
 
 /** All known implementations (build time) **/
 extern const struct leek_implementation leek_impl_openssl;
 extern const struct leek_implementation leek_impl_uint;
+extern const struct leek_implementation leek_impl_vecext;
 extern const struct leek_implementation leek_impl_ssse3;
 extern const struct leek_implementation leek_impl_avx2;
 extern const struct leek_implementation leek_impl_avx512;
+extern const struct leek_implementation leek_impl_avx512vl;
+extern const struct leek_implementation leek_impl_shani;
+extern const struct leek_implementation leek_impl_uintx4;
+extern const struct leek_implementation leek_impl_ssse3x2;
+extern const struct leek_implementation leek_impl_avx2x2;
+extern const struct leek_implementation leek_impl_avx512x2;
 
 /* All built implementations in a nice structure */
 extern const struct leek_implementation *leek_implementations[];
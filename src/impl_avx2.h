@@ -88,6 +88,34 @@ static inline vecx vecx_even_numbers(void)
 	return _mm256_set_epi32(14, 12, 10, 8, 6, 4, 2, 0);
 }
 
+/* Lanes mask where x and y are equal */
+static inline unsigned int vecx_cmpeq_mask(vecx x, vecx y)
+{
+	return _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(x, y)));
+}
+
+
+/* 32b words at indexes given by x */
+static inline vecx vecx_gather(const void *base, vecx x)
+{
+	return _mm256_i32gather_epi32(base, x, 4);
+}
+
+/* Lanes mask of bits set in 'bitmap' at indexes given by x */
+static inline unsigned int vecx_test(vecx x, const void *bitmap)
+{
+	vecx words = _mm256_i32gather_epi32(bitmap, _mm256_srli_epi32(x, 5), 4);
+	vecx bits = _mm256_srlv_epi32(words, _mm256_and_si256(x, _mm256_set1_epi32(31)));
+
+	return _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_slli_epi32(bits, 31)));
+}
+
+/* Lanes mask of bits set in 'bitmap' at indexes given by the 16 LSBs of x */
+static inline unsigned int vecx_probe(vecx x, const void *bitmap)
+{
+	return vecx_test(_mm256_and_si256(x, _mm256_set1_epi32(0xffff)), bitmap);
+}
+
 /**
  * input rows:
  *   a1 b1 c1 d1 e1 f1 g1 h1
@@ -123,6 +151,12 @@ static inline vecx vecx_even_numbers(void)
 #define VECX_IMPL_NAME                     "AVX2"
 #define VECX_IMPL_ISA                      "avx2"
 
+/* Bucket bitmap is probed with a gather (see vecx_probe) */
+#define VECX_PROBE_GATHER                       1
+
+/* Automaton grams are probed with gathers (see leek_vecx_scan) */
+#define VECX_SCAN_GATHER                        1
+
 /* Include macro expansion and generic SHA1 stuff here */
 #include "vecx_core.h"
 
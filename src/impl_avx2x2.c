@@ -0,0 +1,12 @@
+#include "leek.h"
+
+/* Two interleaved vectors per exhaust iteration */
+#define VECX_STREAM_ORDER                       1
+#include "impl_avx2.h"
+
+#undef VECX_IMPL_NAME
+#define VECX_IMPL_NAME                   "AVX2x2"
+
+#include "vecx.h"
+
+LEEK_VECX_DEFINE(leek_impl_avx2x2);
@@ -78,6 +78,34 @@ static inline vecx vecx_even_numbers(void)
 	                        14, 12, 10,  8,  6,  4,  2,  0);
 }
 
+/* Lanes mask where x and y are equal */
+static inline unsigned int vecx_cmpeq_mask(vecx x, vecx y)
+{
+	return _mm512_cmpeq_epi32_mask(x, y);
+}
+
+
+/* 32b words at indexes given by x */
+static inline vecx vecx_gather(const void *base, vecx x)
+{
+	return _mm512_i32gather_epi32(x, base, 4);
+}
+
+/* Lanes mask of bits set in 'bitmap' at indexes given by x */
+static inline unsigned int vecx_test(vecx x, const void *bitmap)
+{
+	vecx words = _mm512_i32gather_epi32(_mm512_srli_epi32(x, 5), bitmap, 4);
+	vecx bits = _mm512_srlv_epi32(words, _mm512_and_si512(x, _mm512_set1_epi32(31)));
+
+	return _mm512_test_epi32_mask(bits, _mm512_set1_epi32(1));
+}
+
+/* Lanes mask of bits set in 'bitmap' at indexes given by the 16 LSBs of x */
+static inline unsigned int vecx_probe(vecx x, const void *bitmap)
+{
+	return vecx_test(_mm512_and_si512(x, _mm512_set1_epi32(0xffff)), bitmap);
+}
+
 /**
  * input rows:
  *   a1 b1 c1 d1 e1 f1 g1 h1 i1 j1 k1 l1 m1 n1 o1 p1
@@ -121,6 +149,15 @@ static inline vecx vecx_even_numbers(void)
 #define VECX_IMPL_NAME                     "AVX512"
 #define VECX_IMPL_ISA                    "avx512bw"
 
+/* Bucket bitmap is probed with a gather (see vecx_probe) */
+#define VECX_PROBE_GATHER                         1
+
+/* Automaton grams are probed with gathers (see leek_vecx_scan) */
+#define VECX_SCAN_GATHER                          1
+
+/* Slower here (ternary logic already makes on the fly words cheap) */
+#define VECX_LINEAR_SCHEDULE                      0
+
 /* Include macro expansion and generic SHA1 stuff here */
 #include "vecx_core.h"
 
@@ -25,12 +25,31 @@ out:
 	return lco;
 }
 
+/* Prebuild the padded final block(s) so that each exponent only costs
+ * a 4 bytes patch and one (or two) block transforms on the midstate. */
 static int leek_openssl_precalc(struct leek_rsa_item *item, const void *ptr, size_t len)
 {
 	struct leek_crypto_openssl *lco = item->private_data;
+	size_t tail_len = len % LEEK_SHA1_BLOCK_SIZE;
+	uint64_t bitlen = htobe64(8 * len);
+
+	/* Exponent must be fully contained in the tail */
+	if (tail_len < LEEK_RSA_E_SIZE)
+		tail_len += LEEK_SHA1_BLOCK_SIZE;
 
 	SHA1_Init(&lco->hash);
-	SHA1_Update(&lco->hash, ptr, len - LEEK_RSA_E_SIZE);
+	SHA1_Update(&lco->hash, ptr, len - tail_len);
+
+	/* Padding needs one byte plus the length (64b) */
+	lco->tail_blocks = (tail_len + 1 + sizeof(bitlen) + LEEK_SHA1_BLOCK_SIZE - 1)
+	                 / LEEK_SHA1_BLOCK_SIZE;
+	lco->expo_offset = tail_len - LEEK_RSA_E_SIZE;
+
+	memset(lco->tail, 0, sizeof(lco->tail));
+	memcpy(lco->tail, (const uint8_t *) ptr + len - tail_len, tail_len);
+	lco->tail[tail_len] = 0x80;
+	memcpy(&lco->tail[LEEK_SHA1_BLOCK_SIZE * lco->tail_blocks - sizeof(bitlen)],
+	       &bitlen, sizeof(bitlen));
 
 	return 0;
 }
@@ -38,36 +57,49 @@ static int leek_openssl_precalc(struct leek_rsa_item *item, const void *ptr, siz
 static int __hot leek_openssl_exhaust(struct leek_rsa_item *item, struct leek_worker *wk)
 {
 	struct leek_crypto_openssl *lco = item->private_data;
-	uint8_t sha1_buffer[SHA_DIGEST_LENGTH];
-	const union leek_rawaddr *sha1_addr;
+	uint8_t *expo_ptr = &lco->tail[lco->expo_offset];
+	union {
+		uint32_t words[3];
+		union leek_rawaddr addr;
+	} sha1;
 	uint32_t e = LEEK_RSA_E_START - 2;
 	uint32_t e_be;
 	SHA_CTX hash;
+	unsigned int common;
 	int length;
 	int ret;
 
-	sha1_addr = (const union leek_rawaddr *) &sha1_buffer;
-
 	/* Here we take advantage of 32b overflow to detect end of loop */
 	while(e < LEEK_RSA_E_LIMIT) {
 		e += 2;
 		e_be = htobe32(e);
+		memcpy(expo_ptr, &e_be, LEEK_RSA_E_SIZE);
 
-		/* Copy internal state and relevant part of internal buffer
-		 * Also copy "num" which is the state of internal buffer */
+		/* Copy the midstate and run the final block(s) */
 		memcpy(&hash, &lco->hash, LEEK_SHA1_COPY_SIZE);
-		hash.num = lco->hash.num;
-
-		SHA1_Update(&hash, &e_be, LEEK_RSA_E_SIZE);
-		SHA1_Final(sha1_buffer, &hash);
-
-		length = leek_result_lookup(sha1_addr);
-		if (unlikely(length)) {
-			ret = leek_result_recheck(item, e, sha1_addr);
+		SHA1_Transform(&hash, lco->tail);
+		if (unlikely(lco->tail_blocks > 1))
+			SHA1_Transform(&hash, lco->tail + LEEK_SHA1_BLOCK_SIZE);
+
+		/* Only the 3 first words are needed for the address */
+		sha1.words[0] = htobe32(hash.h0);
+		sha1.words[1] = htobe32(hash.h1);
+		sha1.words[2] = htobe32(hash.h2);
+
+		if (leek.options.flags & LEEK_OPTION_BEST) {
+			length = leek_result_lookup_best(wk->hashes, &sha1.addr, &common);
+			if (unlikely(common > wk->best_floor) && item->rsa)
+				leek_result_best_push(wk, &sha1.addr, e, common);
+		}
+		else
+			length = leek_result_lookup(wk->hashes, &sha1.addr);
+		/* Synthetic items (see tune.c) have no key to check */
+		if (unlikely(length) && item->rsa) {
+			ret = leek_result_recheck(item, e, &sha1.addr);
 			if (ret < 0)
 				__sync_add_and_fetch(&leek.stats.recheck_failures, 1);
 			else {
-				leek_result_handle(item->rsa, e, length, sha1_addr);
+				leek_result_handle(item->rsa, e, length, &sha1.addr);
 				item->flags |= LEEK_RSA_ITEM_DESTROY;
 			}
 		}
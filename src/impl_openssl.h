@@ -1,11 +1,20 @@
 #ifndef __LEEK_IMPL_OPENSSL_H
 # define __LEEK_IMPL_OPENSSL_H
+# include <stdint.h>
 # include <openssl/sha.h>
 
-# define LEEK_SHA1_COPY_SIZE  (10 * sizeof(SHA_LONG))
+/* Only the midstate words (h0 to h4) are copied for each exponent */
+# define LEEK_SHA1_COPY_SIZE   (5 * sizeof(SHA_LONG))
+# define LEEK_SHA1_BLOCK_SIZE  64
 
 struct leek_crypto_openssl {
+	/* Hash state before the final blocks */
 	SHA_CTX hash;
+
+	/* Padded final blocks (exponent is patched in place) */
+	uint8_t tail[2 * LEEK_SHA1_BLOCK_SIZE];
+	unsigned int tail_blocks;
+	unsigned int expo_offset;
 };
 
 #endif /* !__LEEK_IMPL_OPENSSL_H */
@@ -0,0 +1,298 @@
+#include <cpuid.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "leek.h"
+#include "impl_shani.h"
+#include "lookup.h"
+
+
+/* Expand the provided macro for a single stream or for all streams.
+ * Loops are avoided on purpose so that all states live in registers. */
+#define leek_shani_each_1(m, ...)  m(0, __VA_ARGS__)
+
+#if LEEK_SHANI_STREAM_ORDER == 1
+# define leek_shani_each_n(m, ...) \
+	m(0, __VA_ARGS__) m(1, __VA_ARGS__)
+#elif LEEK_SHANI_STREAM_ORDER == 2
+# define leek_shani_each_n(m, ...) \
+	m(0, __VA_ARGS__) m(1, __VA_ARGS__) m(2, __VA_ARGS__) m(3, __VA_ARGS__)
+#else
+# error "Invalid value for LEEK_SHANI_STREAM_ORDER."
+#endif
+
+/* Reverses all bytes (big-endian words to SHA-NI lane order and back) */
+#define leek_shani_bswap_mask() \
+	_mm_set_epi64x(0x0001020304050607ULL, 0x08090a0b0c0d0e0fULL)
+
+/* Four SHA1 rounds on stream 's', this also computes the next message words */
+#define leek_shani_quad(s, i)                                                \
+	{                                                                          \
+		if ((i) >= 4) {                                                          \
+			__m128i __m = _mm_sha1msg1_epu32(msg[(i) & 3][s], msg[((i) + 1) & 3][s]); \
+			__m = _mm_xor_si128(__m, msg[((i) + 2) & 3][s]);                       \
+			msg[(i) & 3][s] = _mm_sha1msg2_epu32(__m, msg[((i) + 3) & 3][s]);      \
+		}                                                                        \
+		e[s] = ((i) == 0) ? _mm_add_epi32(e[s], msg[0][s])                       \
+		                  : _mm_sha1nexte_epu32(prev[s], msg[(i) & 3][s]);       \
+		prev[s] = abcd[s];                                                       \
+		abcd[s] = _mm_sha1rnds4_epu32(abcd[s], e[s], (i) / 5);                   \
+	}
+
+/* All 80 rounds, interleaved between streams at each step */
+#define leek_shani_rounds(each)                                              \
+	each(leek_shani_quad,  0) each(leek_shani_quad,  1)                        \
+	each(leek_shani_quad,  2) each(leek_shani_quad,  3)                        \
+	each(leek_shani_quad,  4) each(leek_shani_quad,  5)                        \
+	each(leek_shani_quad,  6) each(leek_shani_quad,  7)                        \
+	each(leek_shani_quad,  8) each(leek_shani_quad,  9)                        \
+	each(leek_shani_quad, 10) each(leek_shani_quad, 11)                        \
+	each(leek_shani_quad, 12) each(leek_shani_quad, 13)                        \
+	each(leek_shani_quad, 14) each(leek_shani_quad, 15)                        \
+	each(leek_shani_quad, 16) each(leek_shani_quad, 17)                        \
+	each(leek_shani_quad, 18) each(leek_shani_quad, 19)
+
+
+static int leek_shani_available(void)
+{
+	unsigned int eax, ebx, ecx, edx;
+
+	/* GCC only knows about "sha" in __builtin_cpu_supports since GCC 11 */
+	if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx))
+		return 0;
+
+	return (ebx & bit_SHA) && __builtin_cpu_supports("ssse3");
+}
+
+static void *leek_shani_alloc(void)
+{
+	struct leek_shani *ls;
+
+	ls = aligned_alloc(LEEK_CACHELINE_SZ, sizeof(*ls));
+	if (!ls)
+		goto out;
+	memset(ls, 0, sizeof(*ls));
+
+out:
+	return ls;
+}
+
+static void leek_shani_reset(struct leek_shani *ls)
+{
+	ls->abcd = _mm_set_epi32(LEEK_SHANI_H0, LEEK_SHANI_H1, LEEK_SHANI_H2, LEEK_SHANI_H3);
+	ls->e0 = _mm_set_epi32(LEEK_SHANI_H4, 0, 0, 0);
+}
+
+/* Generic hash function (used for the first blocks) */
+static void leek_shani_update(struct leek_shani *ls, const uint8_t *block)
+{
+	const __m128i mask = leek_shani_bswap_mask();
+	__m128i msg[4][1];
+	__m128i abcd[1];
+	__m128i prev[1];
+	__m128i e[1];
+
+	for (int i = 0; i < 4; ++i)
+		msg[i][0] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) block + i), mask);
+
+	abcd[0] = ls->abcd;
+	prev[0] = ls->abcd;
+	e[0] = ls->e0;
+
+	leek_shani_rounds(leek_shani_each_1);
+
+	ls->e0 = _mm_sha1nexte_epu32(prev[0], ls->e0);
+	ls->abcd = _mm_add_epi32(abcd[0], ls->abcd);
+}
+
+
+/* Build the last block and the masks used to patch the exponent in place */
+static void leek_shani_block_finalize(struct leek_shani *ls, const void *ptr,
+                                      size_t total_len)
+{
+	const __m128i mask = leek_shani_bswap_mask();
+	size_t len = total_len % LEEK_SHANI_BLOCK_SIZE;
+	unsigned int expo_word = (len - LEEK_RSA_E_SIZE) / 4;
+	unsigned int expo_byte = (len - LEEK_RSA_E_SIZE) % 4;
+	uint8_t smask[2][16];
+	uint8_t block[LEEK_SHANI_BLOCK_SIZE];
+	uint64_t bitlen = htobe64(8 * total_len);
+
+	memset(block, 0, sizeof(block));
+	memcpy(block, ptr, len - LEEK_RSA_E_SIZE);
+	block[len] = 0x80;
+	memcpy(&block[LEEK_SHANI_BLOCK_SIZE - sizeof(bitlen)], &bitlen, sizeof(bitlen));
+
+	for (int i = 0; i < 4; ++i)
+		ls->msg[i] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) block + i), mask);
+
+	/* The exponent is shifted in a 64b word where the high part goes to
+	 * word 'expo_word' and the low part (if any) to the following word. */
+	ls->expo_shift = 8 * expo_byte;
+	ls->expo_msg[0] = expo_word / 4;
+	ls->expo_msg[1] = expo_word / 4 + 1;
+
+	memset(smask, 0x80, sizeof(smask));
+	for (unsigned int w = 0; w < 2; ++w) {
+		unsigned int word = expo_word + w;
+		unsigned int lane = 3 - (word % 4);
+		unsigned int midx = word / 4 - ls->expo_msg[0];
+
+		for (unsigned int b = 0; b < 4; ++b)
+			smask[midx][4 * lane + b] = 4 * (1 - w) + b;
+	}
+
+	ls->expo_mask[0] = _mm_loadu_si128((const __m128i *) smask[0]);
+	ls->expo_mask[1] = _mm_loadu_si128((const __m128i *) smask[1]);
+}
+
+
+/* Stage0: pre-compute first full SHA1 blocks */
+static int leek_shani_precalc(struct leek_rsa_item *item, const void *ptr, size_t len)
+{
+	struct leek_shani *ls = item->private_data;
+	size_t rem = len;
+	int ret = -1;
+
+	leek_shani_reset(ls);
+
+	while (rem >= LEEK_SHANI_BLOCK_SIZE) {
+		leek_shani_update(ls, ptr);
+		rem -= LEEK_SHANI_BLOCK_SIZE;
+		ptr = (uint8_t *) ptr + LEEK_SHANI_BLOCK_SIZE;
+	}
+
+	/* These checks are *HIGHLY* improbable in theory, but let's be safe here */
+	if (rem < LEEK_RSA_E_SIZE) {
+		/* This makes it impossible to iterate over exponent in the last block */
+		fprintf(stderr, "SHA1 init failed: too few data in last hash block.\n");
+		goto out;
+	}
+
+	if (rem > (LEEK_SHANI_BLOCK_SIZE - sizeof(uint64_t) - 1)) {
+		/* This makes it impossible to finalize hash in the same block as exponent */
+		fprintf(stderr, "SHA1 init failed: too much data in last hash block.\n");
+		goto out;
+	}
+
+	leek_shani_block_finalize(ls, ptr, len);
+
+	ret = 0;
+out:
+	return ret;
+}
+
+
+/* Load the last block for stream 's' and patch its exponent */
+#define leek_shani_load(s, q)                                                \
+	{                                                                          \
+		uint64_t __e = (uint64_t) (expo + 2 * (s)) << 32;                        \
+		__m128i __p = _mm_cvtsi64_si128(__e >> ls->expo_shift);                  \
+                                                                             \
+		msg[0][s] = ls->msg[0];                                                  \
+		msg[1][s] = ls->msg[1];                                                  \
+		msg[2][s] = ls->msg[2];                                                  \
+		msg[3][s] = ls->msg[3];                                                  \
+		msg[(q)][s] = _mm_or_si128(msg[(q)][s],                                  \
+		                           _mm_shuffle_epi8(__p, ls->expo_mask[0]));     \
+		if ((q) < 3)                                                             \
+			msg[((q) + 1) & 3][s] = _mm_or_si128(msg[((q) + 1) & 3][s],            \
+			                                 _mm_shuffle_epi8(__p, ls->expo_mask[1])); \
+		abcd[s] = ls->abcd;                                                      \
+		prev[s] = ls->abcd;                                                      \
+		e[s] = ls->e0;                                                           \
+	}
+
+/* Store the 3 first words of stream 's' as a raw address */
+#define leek_shani_store(s, mask)                                            \
+	{                                                                          \
+		__m128i __r = _mm_add_epi32(abcd[s], ls->abcd);                          \
+		_mm_storeu_si128((__m128i *) ls->R[s].data, _mm_shuffle_epi8(__r, mask)); \
+	}
+
+
+/* Exhaust loop, specialized on the first message word holding the exponent */
+static __always_inline __hot
+int leek_shani_exhaust_q(struct leek_rsa_item *item, struct leek_worker *wk,
+                         const unsigned int q)
+{
+	struct leek_shani *ls = item->private_data;
+	const __m128i mask = leek_shani_bswap_mask();
+
+	for (uint32_t expo = LEEK_RSA_E_START; expo < LEEK_RSA_E_LIMIT;
+	     expo += 2 * LEEK_SHANI_STREAM_COUNT) {
+		__m128i msg[4][LEEK_SHANI_STREAM_COUNT];
+		__m128i abcd[LEEK_SHANI_STREAM_COUNT];
+		__m128i prev[LEEK_SHANI_STREAM_COUNT];
+		__m128i e[LEEK_SHANI_STREAM_COUNT];
+
+		leek_shani_each_n(leek_shani_load, q);
+		leek_shani_rounds(leek_shani_each_n);
+		leek_shani_each_n(leek_shani_store, mask);
+
+		/* Check results for all streams here */
+		for (int r = 0; r < LEEK_SHANI_STREAM_COUNT; ++r) {
+			union leek_rawaddr *result;
+			unsigned int common;
+			unsigned int length;
+			int ret;
+
+			result = &ls->R[r].addr;
+
+			if (leek.options.flags & LEEK_OPTION_BEST) {
+				length = leek_result_lookup_best(wk->hashes, result, &common);
+				if (unlikely(common > wk->best_floor) && item->rsa)
+					leek_result_best_push(wk, result, expo + 2 * r, common);
+			}
+			else
+				length = leek_result_lookup(wk->hashes, result);
+			/* Synthetic items (see tune.c) have no key to check */
+			if (unlikely(length) && item->rsa) {
+				ret = leek_result_recheck(item, expo + 2 * r, result);
+				if (ret < 0)
+					__sync_add_and_fetch(&leek.stats.recheck_failures, 1);
+				else {
+					leek_result_handle(item->rsa, expo + 2 * r, length, result);
+					item->flags |= LEEK_RSA_ITEM_DESTROY;
+				}
+			}
+		}
+		wk->stats.hash_count += LEEK_SHANI_STREAM_COUNT;
+
+		/* Check for LEEK_WORKER_FLAG_EXITING */
+		if (wk->flags & LEEK_WORKER_FLAG_EXITING)
+			goto exiting;
+	}
+
+	return 1;
+
+exiting:
+	return 0;
+}
+
+static int leek_shani_exhaust(struct leek_rsa_item *item, struct leek_worker *wk)
+{
+	struct leek_shani *ls = item->private_data;
+
+	/* Message indexes need to be immediates for everything to stay in registers */
+	switch (ls->expo_msg[0]) {
+		case 0:
+			return leek_shani_exhaust_q(item, wk, 0);
+		case 1:
+			return leek_shani_exhaust_q(item, wk, 1);
+		case 2:
+			return leek_shani_exhaust_q(item, wk, 2);
+		default:
+			return leek_shani_exhaust_q(item, wk, 3);
+	}
+}
+
+const struct leek_implementation leek_impl_shani = {
+	.name      = "SHANI",
+	.weight    = 6,
+	.available = leek_shani_available,
+	.allocate  = leek_shani_alloc,
+	.precalc   = leek_shani_precalc,
+	.exhaust   = leek_shani_exhaust,
+};
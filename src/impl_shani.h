@@ -0,0 +1,47 @@
+#ifndef __LEEK_IMPL_SHANI_H
+# define __LEEK_IMPL_SHANI_H
+# include <stdint.h>
+# include <immintrin.h>
+
+# include "hashes.h"
+
+/* SHA1 constants (see vecx_core.h) */
+# define LEEK_SHANI_BLOCK_SIZE            64
+# define LEEK_SHANI_H0            0x67452301
+# define LEEK_SHANI_H1            0xefcdab89
+# define LEEK_SHANI_H2            0x98badcfe
+# define LEEK_SHANI_H3            0x10325476
+# define LEEK_SHANI_H4            0xc3d2e1f0
+
+/* Number of independent exponents hashed at the same time (hides latency) */
+# define LEEK_SHANI_STREAM_ORDER          2
+# define LEEK_SHANI_STREAM_COUNT          (1 << LEEK_SHANI_STREAM_ORDER)
+
+/* Digest words stored as big-endian bytes (a, b, c, d) */
+union leek_shani_digest {
+	uint8_t data[16];
+	union leek_rawaddr addr;
+};
+
+struct leek_shani {
+	/* Hash state before last block (a, b, c, d) and e */
+	__m128i abcd;
+	__m128i e0;
+
+	/* Last block message words (exponent bytes are zeroed) */
+	__m128i msg[4];
+
+	/* Shuffle masks used to patch the exponent into message words */
+	__m128i expo_mask[2];
+
+	/* Which message words are patched by each mask above */
+	unsigned int expo_msg[2];
+
+	/* Right shift applied on the exponent (placed in a 64b word) */
+	unsigned int expo_shift;
+
+	/* Final resulting addresses (hashes) */
+	union leek_shani_digest R[LEEK_SHANI_STREAM_COUNT];
+};
+
+#endif /* !__LEEK_IMPL_SHANI_H */
@@ -87,6 +87,12 @@ static inline vecx vecx_even_numbers(void)
 	return _mm_set_epi32(6, 4, 2, 0);
 }
 
+/* Lanes mask where x and y are equal */
+static inline unsigned int vecx_cmpeq_mask(vecx x, vecx y)
+{
+	return _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(x, y)));
+}
+
 /**
  * input rows:
  *   a1 b1 c1 d1
@@ -88,6 +88,12 @@ static inline vecx vecx_even_numbers(void)
 	return 0;
 }
 
+/* Lanes mask where x and y are equal */
+static inline unsigned int vecx_cmpeq_mask(vecx x, vecx y)
+{
+	return (x == y);
+}
+
 #define vecx_transpose(row0, row1, row2, row3)
 
 #define VECX_LANE_ORDER                         0
@@ -95,6 +101,12 @@ static inline vecx vecx_even_numbers(void)
 /* dummy instruction to avoid full rewriting */
 #define VECX_IMPL_ISA                       "mmx"
 
+/* Slower here (no lane to amortize stage 3 on) */
+#define VECX_LINEAR_SCHEDULE                    0
+
+/* A single bitmap probe costs about as much as a compare */
+#define VECX_MATCH_MAX                          1
+
 /* Include macro expansion and generic SHA1 stuff here */
 #include "vecx_core.h"
 
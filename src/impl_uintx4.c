@@ -0,0 +1,12 @@
+#include "leek.h"
+
+/* Four interleaved scalar hashes per exhaust iteration (exposes ILP) */
+#define VECX_STREAM_ORDER                       2
+#include "impl_uint.h"
+
+#undef VECX_IMPL_NAME
+#define VECX_IMPL_NAME                 "UINT32x4"
+
+#include "vecx.h"
+
+LEEK_VECX_DEFINE(leek_impl_uintx4);
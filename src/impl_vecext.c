@@ -0,0 +1,5 @@
+#include "leek.h"
+#include "impl_vecext.h"
+#include "vecx.h"
+
+LEEK_VECX_DEFINE(leek_impl_vecext);
@@ -0,0 +1,154 @@
+#ifndef __LEEK_IMPL_VECEXT_H
+# define __LEEK_IMPL_VECEXT_H
+# include <stdint.h>
+# include <string.h>
+
+/* Lane count is selected at configure time (--with-vector-lanes) */
+# ifndef LEEK_VECEXT_LANE_ORDER
+#  define LEEK_VECEXT_LANE_ORDER  3
+# endif
+
+/* Compiler vector extensions: 4 to 32 x 32b lanes, mapped by the compiler
+ * on whatever instruction set the package is built for (-march). */
+typedef uint32_t vecx __attribute__((vector_size(4 << LEEK_VECEXT_LANE_ORDER)));
+
+static inline vecx vecx_zero(void)
+{
+	return (vecx) { 0 };
+}
+
+static inline vecx vecx_set(uint32_t x)
+{
+	return vecx_zero() + x;
+}
+
+static inline vecx vecx_load(const void *ptr)
+{
+	vecx x;
+
+	memcpy(&x, ptr, sizeof(x));
+	return x;
+}
+
+static inline void vecx_store(void *ptr, vecx x)
+{
+	memcpy(ptr, &x, sizeof(x));
+}
+
+static inline vecx vecx_or(vecx x, vecx y)
+{
+	return (x | y);
+}
+
+static inline vecx vecx_xor(vecx x, vecx y)
+{
+	return (x ^ y);
+}
+
+static inline vecx vecx_and(vecx x, vecx y)
+{
+	return (x & y);
+}
+
+static inline vecx vecx_anot(vecx x, vecx y)
+{
+	return (~x & y);
+}
+
+static inline vecx vecx_add(vecx x, vecx y)
+{
+	return (x + y);
+}
+
+static inline vecx vecx_shl(vecx x, int y)
+{
+	return (x << y);
+}
+
+static inline vecx vecx_shr(vecx x, int y)
+{
+	return (x >> y);
+}
+
+static inline vecx vecx_rol(vecx x, int y)
+{
+	vecx a = vecx_shl(x, y);
+	vecx b = vecx_shr(x, 32 - y);
+	return vecx_or(a, b);
+}
+
+static inline vecx vecx_ror(vecx x, int y)
+{
+	vecx a = vecx_shr(x, y);
+	vecx b = vecx_shl(x, 32 - y);
+	return vecx_or(a, b);
+}
+
+static inline vecx vecx_bswap(vecx x)
+{
+	/* Compilers turn this into byte shuffles when available */
+	return (x << 24) | ((x & 0xff00) << 8) | ((x >> 8) & 0xff00) | (x >> 24);
+}
+
+static inline vecx vecx_even_numbers(void)
+{
+	vecx x;
+
+	for (unsigned int i = 0; i < (1 << LEEK_VECEXT_LANE_ORDER); ++i)
+		x[i] = 2 * i;
+	return x;
+}
+
+/* Lanes mask where x and y are equal */
+static inline unsigned int vecx_cmpeq_mask(vecx x, vecx y)
+{
+	vecx eq = (vecx) (x == y);
+	unsigned int mask = 0;
+
+	for (unsigned int i = 0; i < (1 << LEEK_VECEXT_LANE_ORDER); ++i)
+		mask |= (eq[i] & 1) << i;
+	return mask;
+}
+
+/**
+ * input rows (n lanes):
+ *   a1 b1 ... n1
+ *   a2 b2 ... n2
+ *   a3 b3 ... n3
+ *   a4 b4 ... n4
+ *
+ * output rows (read sequentially):
+ *   a1 a2 a3 a4 b1 b2 b3 b4 ... n1 n2 n3 n4
+ */
+static inline void vecx_transpose_rows(vecx *rows[4])
+{
+	uint32_t out[4 << LEEK_VECEXT_LANE_ORDER];
+
+	for (unsigned int j = 0; j < 4; ++j) {
+		for (unsigned int i = 0; i < (1 << LEEK_VECEXT_LANE_ORDER); ++i)
+			out[4 * i + j] = (*rows[j])[i];
+	}
+
+	for (unsigned int j = 0; j < 4; ++j)
+		*rows[j] = vecx_load(&out[j << LEEK_VECEXT_LANE_ORDER]);
+}
+
+#define vecx_transpose(row0, row1, row2, row3)                          \
+	do {                                                                  \
+		vecx *__rows[4] = { &(row0), &(row1), &(row2), &(row3) };           \
+		vecx_transpose_rows(__rows);                                        \
+	} while (0)
+
+
+#define VECX_LANE_ORDER            LEEK_VECEXT_LANE_ORDER
+#define VECX_IMPL_NAME                         "VECEXT"
+/* dummy instruction (built for the target instruction set anyway) */
+#define VECX_IMPL_ISA                             "mmx"
+
+/* Only preferred over the plain uint32_t implementation */
+#define VECX_IMPL_WEIGHT                             2
+
+/* Include macro expansion and generic SHA1 stuff here */
+#include "vecx_core.h"
+
+#endif /* !__LEEK_IMPL_VECEXT_H */
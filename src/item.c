@@ -276,24 +276,24 @@ free_p:
 }
 
 
-static void *leek_impl_allocate(void)
+static void *leek_impl_allocate(struct leek_rsa_item *item)
 {
-	return leek.implementation->allocate();
+	return item->impl->allocate();
 }
 
 
-static void leek_impl_cleanup(void *private_data)
+static void leek_impl_cleanup(struct leek_rsa_item *item)
 {
-	if (leek.implementation->cleanup)
-		leek.implementation->cleanup(private_data);
+	if (item->impl->cleanup)
+		item->impl->cleanup(item->private_data);
 	else
-		free(private_data);
+		free(item->private_data);
 }
 
 
 static int leek_impl_precalc(struct leek_rsa_item *item, const uint8_t *der, size_t len)
 {
-	return leek.implementation->precalc(item, der, len);
+	return item->impl->precalc(item, der, len);
 }
 
 
@@ -326,7 +326,7 @@ static int leek_item_crypto_init(struct leek_rsa_item *item)
 		goto out;
 	}
 
-	prv = leek_impl_allocate();
+	prv = leek_impl_allocate(item);
 	if (!prv)
 		goto out;
 	item->private_data = prv;
@@ -374,13 +374,13 @@ void leek_item_destroy(struct leek_rsa_item *item)
 		if (item->rsa)
 			RSA_free(item->rsa);
 		if (item->private_data)
-			leek_impl_cleanup(item->private_data);
+			leek_impl_cleanup(item);
 		free(item);
 	}
 }
 
 
-struct leek_rsa_item *leek_item_generate(void)
+struct leek_rsa_item *leek_item_generate(const struct leek_implementation *impl)
 {
 	struct leek_rsa_item *item;
 	int ret;
@@ -389,6 +389,7 @@ struct leek_rsa_item *leek_item_generate(void)
 	if (!item)
 		goto out;
 	memset(item, 0, sizeof *item);
+	item->impl = impl;
 
 	ret = leek_item_primes_init(item);
 	if (ret < 0)
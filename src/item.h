@@ -6,6 +6,8 @@
 
 # include "primes.h"
 
+struct leek_implementation;
+
 
 struct leek_rsa_item {
 	/* Internal prime P used for RSA structure */
@@ -15,6 +17,9 @@ struct leek_rsa_item {
 
 	RSA *rsa;           /* Generated RSA key-pair */
 
+	/* Implementation owning private data below */
+	const struct leek_implementation *impl;
+
 	void *private_data; /* Implementation specific data */
 	unsigned int flags; /* Dynamic flags linked to this item */
 };
@@ -24,8 +29,8 @@ enum {
 };
 
 
-/* Generate a new RSA item ready for duty */
-struct leek_rsa_item *leek_item_generate(void);
+/* Generate a new RSA item ready for duty on the provided implementation */
+struct leek_rsa_item *leek_item_generate(const struct leek_implementation *impl);
 
 /* Free an allocated RSA item */
 void leek_item_destroy(struct leek_rsa_item *item);
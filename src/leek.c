@@ -22,6 +22,7 @@ static void leek_exit(void)
 	leek_workers_stop();
 	leek_primes_exit();
 	leek_events_exit();
+	leek_topology_exit();
 	leek_hashes_clean();
 	leek_openssl_exit();
 }
@@ -65,10 +66,31 @@ static int leek_init(void)
 	if (ret < 0)
 		goto hashes_exit;
 
+	/* Processor topology for thread counts and worker placement */
+	ret = leek_topology_init();
+	if (ret < 0)
+		goto hashes_exit;
+
+	/* Measure implementations and thread counts (needs loaded hashes) */
+	if (leek.options.flags & LEEK_OPTION_AUTO) {
+		ret = leek_tune_auto();
+		if (ret < 0)
+			goto topology_exit;
+	}
+
+	/* Select the fastest kernel variant (needs loaded hashes for lookups) */
+	if (!(leek.options.flags & LEEK_OPTION_NO_TUNE)) {
+		ret = leek_tune();
+		if (ret < 0)
+			goto topology_exit;
+	}
+
 	ret = 0;
 out:
 	return ret;
 
+topology_exit:
+	leek_topology_exit();
 hashes_exit:
 	leek_hashes_clean();
 openssl_exit:
@@ -8,6 +8,8 @@
 # include "primes.h"
 # include "stats.h"
 # include "terminal.h"
+# include "topology.h"
+# include "tune.h"
 # include "worker.h"
 
 # define LEEK_CPU_VERSION          VERSION
@@ -17,6 +19,9 @@ struct leek_context {
 	/* Chosen implementation (best available by default) */
 	const struct leek_implementation *implementation;
 
+	/* Implementation used on SMT siblings (with mixed placement) */
+	const struct leek_implementation *sibling_implementation;
+
 	/* All command line options */
 	struct leek_options options;
 
@@ -29,6 +34,9 @@ struct leek_context {
 	/* Prime number sub-system for RSA generation */
 	struct leek_primes primes;
 
+	/* Processor topology (used for thread counts and placement) */
+	struct leek_topology topology;
+
 	/* All worker structures (one per-thread) */
 	struct leek_workers workers;
 
@@ -1,43 +1,146 @@
 #ifndef __LEEK_LOOKUP_H
 # define __LEEK_LOOKUP_H
+# include <endian.h>
 # include <stdint.h>
 
 # include "hashes.h"
 
-/* Lookup masks for last 64 LSBs (used by lookup functions) */
-static uint64_t leek_lookup_mask[LEEK_PREFIX_LENGTH_MAX + 1] = {
-	0xFFFFFFFFFFFFFFFF, /* impossible (len = 0) */
-	0xFFFFFFFFFFFFFFFF, /* disabled   (len = 1) */
-	0xFFFFFFFFFFFFFFFF, /* disabled   (len = 2) */
-	0xFFFFFFFFFFFFFFFF, /* disabled   (len = 3) */
-	0xFFFFFFFFFFFFFF0F,
-	0xFFFFFFFFFFFF7F00,
-	0xFFFFFFFFFFFF0300,
-	0xFFFFFFFFFF1F0000,
-	0xFFFFFFFFFF000000,
-	0xFFFFFFFF07000000,
-	0xFFFFFF3F00000000,
-	0xFFFFFF0100000000,
-	0xFFFF0F0000000000,
-	0xFF7F000000000000,
-	0xFF03000000000000,
-	0x1F00000000000000,
-	0x0000000000000000,
-};
-
-static unsigned int leek_result_lookup(const union leek_rawaddr *addr)
+/* Tells whether an address index holds any hash (see hashes.c) */
+static __always_inline
+unsigned int leek_result_probe(const struct leek_hashes *hashes, uint16_t index)
 {
-	struct leek_hash_bucket *bucket = &leek.hashes.bucket[addr->index];
-	uint64_t val;
-
-	if (bucket->cur_count) {
-		for (unsigned int i = leek.options.len_min; i <= leek.options.len_max; ++i) {
-			val = addr->suffix | leek_lookup_mask[i];
-			if (leek_bucket_lookup(bucket, val))
-				return i;
-		}
+	return (hashes->bitmap[index / 64] >> (index % 64)) & 1;
+}
+
+/* Issues loads for the first memory accesses of leek_result_lookup
+ * This lets workers resolve lookups a few iterations later (see --lookup-depth) */
+static __always_inline
+void leek_result_prefetch(const struct leek_hashes *hashes,
+                          const union leek_rawaddr *addr)
+{
+	uint16_t index = be16toh(addr->index);
+	uint64_t key = be64toh(addr->suffix);
+	uint64_t hash;
+
+	if (hashes->fold_count)
+		leek_hashes_fold(hashes, hashes->stats.len_max, &index, &key);
+
+	if (hashes->automaton.delta)
+		__builtin_prefetch(hashes->automaton.delta);
+	else if (hashes->patterns)
+		__builtin_prefetch(&hashes->pattern_offsets[index]);
+	else if (hashes->filter.fingerprints) {
+		uint64_t mask = leek_hash_key_mask(hashes->stats.len_min);
+
+		leek_filter_prefetch(&hashes->filter,
+		                     leek_hashes_filter_key(index, key & mask));
+	}
+	else if (hashes->table) {
+		key &= leek_hash_key_mask(hashes->table_length);
+		hash = leek_hashes_table_hash(index, key);
+		__builtin_prefetch(&hashes->table[leek_hashes_table_bucket(hashes, hash)]);
+		__builtin_prefetch(&hashes->table[leek_hashes_table_bucket(hashes, hash >> 32)]);
 	}
+	else
+		__builtin_prefetch(&hashes->offsets[leek_hashes_slot(hashes, index, key)]);
+}
+
+/* Length of the longest loaded prefix matching this address (or 0)
+ * Workers use their own copy of lookup structures (see --numa) */
+static __always_inline
+unsigned int leek_result_lookup(const struct leek_hashes *hashes,
+                                const union leek_rawaddr *addr)
+{
+	unsigned int length;
+	uint16_t index;
+	uint64_t key;
+	uint32_t slot = 0;
+	uint32_t next = 0;
+
+	if (!leek_result_probe(hashes, addr->index))
+		return 0;
+
+	index = be16toh(addr->index);
+	key = be64toh(addr->suffix);
+
+	/* Bitmap is on raw addresses, everything else on folded ones */
+	if (hashes->fold_count)
+		leek_hashes_fold(hashes, hashes->stats.len_max, &index, &key);
+
+	if (hashes->automaton.delta)
+		return leek_automaton_search(&hashes->automaton, index, key);
+
+	if (hashes->patterns)
+		return leek_hashes_pattern_search(hashes, index, key);
+
+	if (hashes->filter.fingerprints) {
+		uint64_t mask = leek_hash_key_mask(hashes->stats.len_min);
+
+		if (!leek_filter_contains(&hashes->filter,
+		                          leek_hashes_filter_key(index, key & mask)))
+			return 0;
+		__sync_fetch_and_add(&leek.hashes.filter.stats.passed, 1);
+	}
+
+	if (hashes->table)
+		length = leek_hashes_table_search(hashes, index, key);
+	else {
+		slot = leek_hashes_slot(hashes, index, key);
+		next = leek_hashes_successor(hashes, slot, key);
+		length = leek_hashes_prefix(hashes, slot, key, next, LEEK_ADDRESS_LEN);
+	}
+
+	if (!length && hashes->filter.fingerprints)
+		__sync_fetch_and_add(&leek.hashes.filter.stats.false_positives, 1);
+
+	if (likely(!hashes->second) || !length)
+		return length;
+
+	/* Shorter first words are tried as well until a second word follows them
+	 * (all prefixes loaded in the cuckoo table have the same length) */
+	do {
+		unsigned int found = leek_hashes_second(hashes->second, index, key, length);
+
+		if (found)
+			return found;
+		if (hashes->table)
+			break;
+		length = leek_hashes_prefix(hashes, slot, key, next, length - 1);
+	} while (length);
+
 	return 0;
 }
 
+/* Same as leek_result_lookup with the number of characters shared with the
+ * closest loaded prefix (see --best), from a single search in the sorted index */
+static __always_inline
+unsigned int leek_result_lookup_best(const struct leek_hashes *hashes,
+                                     const union leek_rawaddr *addr,
+                                     unsigned int *common)
+{
+	unsigned int length;
+	uint16_t index;
+	uint64_t key;
+	uint32_t slot;
+	uint32_t next;
+
+	*common = 0;
+	if (!leek_result_probe(hashes, addr->index))
+		return 0;
+
+	index = be16toh(addr->index);
+	key = be64toh(addr->suffix);
+	if (hashes->fold_count)
+		leek_hashes_fold(hashes, hashes->stats.len_max, &index, &key);
+
+	slot = leek_hashes_slot(hashes, index, key);
+	next = leek_hashes_successor(hashes, slot, key);
+
+	length = leek_hashes_prefix(hashes, slot, key, next, LEEK_ADDRESS_LEN);
+	if (!length)
+		*common = leek_hashes_common(hashes, slot, key, next);
+
+	return length;
+}
+
 #endif /* !__LEEK_LOOKUP_H */
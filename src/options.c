@@ -18,9 +18,23 @@ static const struct option leek_long_options[] = {
 	{"threads",    1, 0, 't'},
 	{"impl",       1, 0, 'I'},
 	{"stop",       2, 0, 's'},
+	{"auto",       0, 0, 'a'},
 	{"verbose",    0, 0, 'v'},
 	{"help",       0, 0, 'h'},
 	{"no-results", 0, 0, 0x1},
+	{"no-tune",    0, 0, 0x2},
+	{"placement",  1, 0, 0x3},
+	{"sibling",    1, 0, 0x4},
+	{"compact",    0, 0, 0x5},
+	{"mlock",      0, 0, 0x6},
+	{"numa",       2, 0, 0x7},
+	{"lookup-depth", 1, 0, 0x8},
+	{"pattern",    0, 0, 0x9},
+	{"substring",  0, 0, 0xA},
+	{"suffix",     0, 0, 0xB},
+	{"best",       2, 0, 0xC},
+	{"variants",   2, 0, 0xD},
+	{"second",     1, 0, 0xE},
 	{NULL,         0, 0, 0x0},
 };
 
@@ -39,9 +53,26 @@ static void leek_usage_show(FILE *fp, const char *prog_name)
 	fprintf(fp, " -t, --threads=#    worker threads count (default is all cores).\n");
 	fprintf(fp, " -I, --impl=#       select implementation (see bellow).\n");
 	fprintf(fp, " -s, --stop(=1)     stop processing after # success (default is infinite).\n");
+	fprintf(fp, " -a, --auto         select implementation and threads count from measures.\n");
 	fprintf(fp, " -v, --verbose      show verbose run information.\n");
 	fprintf(fp, " -h, --help         show this help and exit.\n");
 	fprintf(fp, "     --no-results   do not display live results on stdout.\n");
+	fprintf(fp, "     --no-tune      do not select the fastest kernel variant at startup.\n");
+	fprintf(fp, "     --placement=#  worker placement policy (none, spread, mixed).\n");
+	fprintf(fp, "     --sibling=#    implementation on SMT siblings (mixed placement).\n");
+	fprintf(fp, "     --compact      compress loaded prefixes (slower lookups, less memory).\n");
+	fprintf(fp, "     --mlock        lock lookup structures in memory.\n");
+	fprintf(fp, "     --numa(=#)     copy lookup structures on each NUMA node (# fakes nodes).\n");
+	fprintf(fp, "     --lookup-depth=# defer full lookups by # iterations [0-%u] (default %u).\n",
+	        LEEK_LOOKUP_DEPTH_MAX, LEEK_LOOKUP_DEPTH_DEFAULT);
+	fprintf(fp, "     --pattern      read prefixes as patterns (see README).\n");
+	fprintf(fp, "     --substring    look for prefixes anywhere in addresses.\n");
+	fprintf(fp, "     --suffix       look for prefixes at the end of addresses.\n");
+	fprintf(fp, "     --best(=%u)    keep the best partial matches (shown with 'f').\n",
+	        LEEK_BEST_COUNT_DEFAULT);
+	fprintf(fp, "     --variants(=#) look-alike characters match (default %s).\n",
+	        LEEK_VARIANTS_DEFAULT);
+	fprintf(fp, "     --second=FILE  words found right after prefixes (see README).\n");
 	fprintf(fp, "\n");
 
 	fprintf(fp, "Available implementations:\n");
@@ -55,6 +86,22 @@ static void leek_usage_show(FILE *fp, const char *prog_name)
 }
 
 
+static int leek_placement_parse(const char *name)
+{
+	static const char *const policies[] = {
+		[LEEK_PLACEMENT_NONE]   = "none",
+		[LEEK_PLACEMENT_SPREAD] = "spread",
+		[LEEK_PLACEMENT_MIXED]  = "mixed",
+	};
+
+	for (unsigned int i = 0; i < ARRAY_SIZE(policies); ++i) {
+		if (!strcmp(name, policies[i]))
+			return i;
+	}
+	return -1;
+}
+
+
 static int leek_range_parse(const char *ptr_a,
                             unsigned int *arg_a, unsigned int *arg_b)
 {
@@ -138,11 +185,21 @@ done:
 
 static int leek_options_check(void)
 {
+	unsigned int modes;
 	int ret = 0;
 
 	if (leek.options.implementation)
 		ret = leek_implementation_select(leek.options.implementation);
 
+	if (leek.options.placement == LEEK_PLACEMENT_MIXED) {
+		if (leek_implementation_sibling_select(leek.options.sibling_impl) < 0)
+			ret = -1;
+	}
+
+	/* Workers need to stay on their node */
+	if ((leek.options.flags & LEEK_OPTION_NUMA) && leek.options.placement == LEEK_PLACEMENT_NONE)
+		leek.options.placement = LEEK_PLACEMENT_SPREAD;
+
 	if (!leek.options.threads || leek.options.threads > LEEK_THREADS_MAX) {
 		fprintf(stderr, "error: thread count must be in range [1 - %u].\n", LEEK_THREADS_MAX);
 		ret = -1;
@@ -161,6 +218,27 @@ static int leek_options_check(void)
 		ret = -1;
 	}
 
+	modes = leek.options.flags & (LEEK_OPTION_PATTERN | LEEK_OPTION_SUBSTRING | LEEK_OPTION_SUFFIX);
+	if (modes & (modes - 1)) {
+		fprintf(stderr, "error: pattern, substring and suffix modes are exclusive.\n");
+		ret = -1;
+	}
+
+	if ((leek.options.flags & LEEK_OPTION_BEST) && modes) {
+		fprintf(stderr, "error: best partial matches are only tracked on prefixes.\n");
+		ret = -1;
+	}
+
+	if ((leek.options.flags & LEEK_OPTION_VARIANTS) && modes) {
+		fprintf(stderr, "error: variants are only supported on prefixes.\n");
+		ret = -1;
+	}
+
+	if ((leek.options.flags & LEEK_OPTION_SECOND) && (modes || (leek.options.flags & LEEK_OPTION_BEST))) {
+		fprintf(stderr, "error: second words are only supported on prefixes.\n");
+		ret = -1;
+	}
+
 	if (!leek.options.prefix_file && !leek.options.prefix_single) {
 		fprintf(stderr, "error: no prefix file or single prefix provided.\n");
 		ret = -1;
@@ -181,12 +259,13 @@ int leek_options_parse(int argc, char *argv[])
 
 	/* These are default values */
 	leek.options.threads = get_nprocs();
+	leek.options.lookup_depth = LEEK_LOOKUP_DEPTH_DEFAULT;
 
 	while (1) {
 		unsigned long uval;
 		int c;
 
-		c = getopt_long(argc, argv, "l:d:r:p:i:o:I:t:s::vh", leek_long_options, NULL);
+		c = getopt_long(argc, argv, "l:d:r:p:i:o:I:t:s::avh", leek_long_options, NULL);
 		if (c == -1)
 			break;
 
@@ -257,6 +336,10 @@ int leek_options_parse(int argc, char *argv[])
 				}
 				break;
 
+			case 'a':
+				leek.options.flags |= LEEK_OPTION_AUTO;
+				break;
+
 			case 'v':
 				leek.options.flags |= LEEK_OPTION_VERBOSE;
 				break;
@@ -269,6 +352,89 @@ int leek_options_parse(int argc, char *argv[])
 				leek.options.flags &= ~LEEK_OPTION_SHOW_RESULTS;
 				break;
 
+			case 0x2:
+				leek.options.flags |= LEEK_OPTION_NO_TUNE;
+				break;
+
+			case 0x3:
+				ret = leek_placement_parse(optarg);
+				if (ret < 0) {
+					fprintf(stderr, "error: unknown placement policy (accepted are none, spread, mixed).\n");
+					goto out;
+				}
+				leek.options.placement = ret;
+				break;
+
+			case 0x4:
+				leek.options.sibling_impl = optarg;
+				break;
+
+			case 0x5:
+				leek.options.flags |= LEEK_OPTION_COMPACT;
+				break;
+
+			case 0x6:
+				leek.options.flags |= LEEK_OPTION_MLOCK;
+				break;
+
+			case 0x7:
+				leek.options.flags |= LEEK_OPTION_NUMA;
+				if (optarg) {
+					uval = strtoul(optarg, NULL, 10);
+					if (errno == ERANGE || !uval || uval > LEEK_THREADS_MAX) {
+						fprintf(stderr, "error: unable to read NUMA nodes argument.\n");
+						goto out;
+					}
+					leek.options.numa_nodes = uval;
+				}
+				break;
+
+			case 0x8:
+				uval = strtoul(optarg, NULL, 10);
+				if (errno == ERANGE || uval > LEEK_LOOKUP_DEPTH_MAX) {
+					fprintf(stderr, "error: lookup depth must be in range [0 - %u].\n",
+					        LEEK_LOOKUP_DEPTH_MAX);
+					goto out;
+				}
+				leek.options.lookup_depth = uval;
+				break;
+
+			case 0x9:
+				leek.options.flags |= LEEK_OPTION_PATTERN;
+				break;
+
+			case 0xA:
+				leek.options.flags |= LEEK_OPTION_SUBSTRING;
+				break;
+
+			case 0xB:
+				leek.options.flags |= LEEK_OPTION_SUFFIX;
+				break;
+
+			case 0xC:
+				leek.options.flags |= LEEK_OPTION_BEST;
+				leek.options.best_count = LEEK_BEST_COUNT_DEFAULT;
+				if (optarg) {
+					uval = strtoul(optarg, NULL, 10);
+					if (errno == ERANGE || !uval || uval > LEEK_BEST_COUNT_MAX) {
+						fprintf(stderr, "error: best matches count must be in range [1 - %u].\n",
+						        LEEK_BEST_COUNT_MAX);
+						goto out;
+					}
+					leek.options.best_count = uval;
+				}
+				break;
+
+			case 0xD:
+				leek.options.flags |= LEEK_OPTION_VARIANTS;
+				leek.options.variants = optarg ? optarg : LEEK_VARIANTS_DEFAULT;
+				break;
+
+			case 0xE:
+				leek.options.flags |= LEEK_OPTION_SECOND;
+				leek.options.second_file = optarg;
+				break;
+
 			default:
 				leek_usage_show(stderr, argv[0]);
 				goto out;
@@ -5,6 +5,11 @@
 # define LEEK_PREFIX_LENGTH_MIN                4u
 # define LEEK_PREFIX_LENGTH_MAX  LEEK_ADDRESS_LEN
 # define LEEK_THREADS_MAX                    512u
+# define LEEK_LOOKUP_DEPTH_MAX                 7u
+# define LEEK_LOOKUP_DEPTH_DEFAULT             1u
+# define LEEK_BEST_COUNT_DEFAULT              16u
+# define LEEK_BEST_COUNT_MAX                 256u
+# define LEEK_VARIANTS_DEFAULT     "3e4a5s6g7t2z"
 
 
 	/* Structure holding configuration from argument parsing */
@@ -13,11 +18,18 @@ struct leek_options {
 	const char *prefix_single;  /* Single prefix mode */
 	const char *result_dir;     /* Output directory */
 	const char *implementation; /* Choosen implementation */
+	const char *sibling_impl;   /* Implementation on SMT siblings */
+	const char *variants;       /* Folded characters (with LEEK_OPTION_VARIANTS) */
+	const char *second_file;    /* Second words file (with LEEK_OPTION_SECOND) */
 
 	unsigned int threads;       /* Number of running threads */
 	unsigned int stop_count;    /* Stop after # successes (with LEEK_FLAG_STOP) */
 	unsigned long duration;     /* For how long we shall run */
 	unsigned long refresh;      /* How often to refresh stats */
+	unsigned int placement;     /* Worker placement policy (see bellow) */
+	unsigned int numa_nodes;    /* Fake NUMA nodes count (with LEEK_OPTION_NUMA) */
+	unsigned int lookup_depth;  /* Kernel iterations before a full lookup */
+	unsigned int best_count;    /* Best partial matches kept (with LEEK_OPTION_BEST) */
 
 	unsigned int len_min;       /* Minimum prefix size */
 	unsigned int len_max;       /* Maximum prefix size */
@@ -36,6 +48,39 @@ enum {
 	LEEK_OPTION_SINGLE       = (1 << 2),
 	/* Run with a higher verbosity level */
 	LEEK_OPTION_SHOW_RESULTS = (1 << 3),
+	/* Skip kernel variants autotune at startup */
+	LEEK_OPTION_NO_TUNE      = (1 << 4),
+	/* Select implementation and thread count from measures */
+	LEEK_OPTION_AUTO         = (1 << 5),
+	/* Store loaded prefixes in a compressed index */
+	LEEK_OPTION_COMPACT      = (1 << 6),
+	/* Lock lookup structures in memory */
+	LEEK_OPTION_MLOCK        = (1 << 7),
+	/* Replicate lookup structures on each NUMA node */
+	LEEK_OPTION_NUMA         = (1 << 8),
+	/* Prefixes are patterns with wildcards and character classes */
+	LEEK_OPTION_PATTERN      = (1 << 9),
+	/* Prefixes are words found anywhere in addresses */
+	LEEK_OPTION_SUBSTRING    = (1 << 10),
+	/* Prefixes are words found at the end of addresses */
+	LEEK_OPTION_SUFFIX       = (1 << 11),
+	/* Keep the best partial matches on a leaderboard */
+	LEEK_OPTION_BEST         = (1 << 12),
+	/* Look-alike characters match each other in prefixes */
+	LEEK_OPTION_VARIANTS     = (1 << 13),
+	/* Prefixes may be followed by a word from a second list */
+	LEEK_OPTION_SECOND       = (1 << 14),
+};
+
+/* Worker placement policies */
+enum {
+	/* Workers are not pinned and all use the same implementation */
+	LEEK_PLACEMENT_NONE,
+	/* Workers are pinned, one per physical core first */
+	LEEK_PLACEMENT_SPREAD,
+	/* Workers are pinned by SMT sibling pairs, with a different
+	 * implementation on siblings (see --sibling) */
+	LEEK_PLACEMENT_MIXED,
 };
 
 /* Parse options and fill the options structure */
@@ -0,0 +1,176 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pattern.h"
+
+
+/* Symbol number of a base32 character (or -1) */
+static int leek_pattern_symbol(char c)
+{
+	if (c >= 'a' && c <= 'z')
+		return c - 'a';
+	if (c >= '2' && c <= '7')
+		return c - '2' + 26;
+	return -1;
+}
+
+
+/* Parse a character class (ptr is after the opening bracket) */
+static const char *leek_pattern_class(uint32_t *mask, const char *ptr)
+{
+	uint32_t value = 0;
+	int negate = 0;
+
+	if (*ptr == '^') {
+		negate = 1;
+		ptr++;
+	}
+
+	while (*ptr != ']') {
+		int first = leek_pattern_symbol(ptr[0]);
+		int last = first;
+
+		if (first < 0)
+			return NULL;
+
+		if (ptr[1] == '-' && ptr[2] != ']') {
+			last = leek_pattern_symbol(ptr[2]);
+			if (last < first)
+				return NULL;
+			ptr += 2;
+		}
+
+		for (int s = first; s <= last; ++s)
+			value |= (1U << s);
+		ptr++;
+	}
+
+	*mask = negate ? ~value : value;
+	return (*mask) ? ptr + 1 : NULL;
+}
+
+
+/* Single symbols are set in the address masks, others are kept as classes */
+static void leek_pattern_finalize(struct leek_pattern *pattern)
+{
+	unsigned __int128 mask = 0;
+	unsigned __int128 value = 0;
+
+	for (unsigned int i = 0; i < pattern->length; ++i) {
+		unsigned int shift = 8 * LEEK_RAWADDR_LEN - LEEK_RAWADDR_CHAR_BITS * (i + 1);
+		uint32_t symbols = pattern->masks[i];
+
+		if (__builtin_popcount(symbols) == 1) {
+			mask |= (unsigned __int128) 0x1F << shift;
+			value |= (unsigned __int128) __builtin_ctz(symbols) << shift;
+		}
+		else if (symbols != LEEK_PATTERN_ANY)
+			pattern->classes |= (1U << i);
+	}
+
+	pattern->index_mask = mask >> 64;
+	pattern->index_value = value >> 64;
+	pattern->key_mask = mask;
+	pattern->key_value = value;
+}
+
+
+int leek_pattern_compile(struct leek_pattern *pattern, const char *source)
+{
+	const char *ptr = source;
+	unsigned int count = 0;
+	int ret = -1;
+
+	memset(pattern, 0, sizeof(*pattern));
+
+	while (*ptr) {
+		unsigned long repeat;
+		uint32_t mask;
+		char *end;
+
+		switch (*ptr) {
+			case '*':
+				if (ptr[1])
+					goto out;
+				ptr++;
+				continue;
+
+			case '{':
+				repeat = strtoul(ptr + 1, &end, 10);
+				if (   !count || end == ptr + 1 || *end != '}'
+				    || !repeat || repeat > LEEK_ADDRESS_LEN - count + 1)
+					goto out;
+
+				for (unsigned int i = 1; i < repeat; ++i, ++count)
+					pattern->masks[count] = pattern->masks[count - 1];
+				ptr = end + 1;
+				continue;
+
+			case '[':
+				ptr = leek_pattern_class(&mask, ptr + 1);
+				if (!ptr)
+					goto out;
+				break;
+
+			case '?':
+				mask = LEEK_PATTERN_ANY;
+				ptr++;
+				break;
+
+			default:
+				if (leek_pattern_symbol(*ptr) < 0)
+					goto out;
+				mask = 1U << leek_pattern_symbol(*ptr);
+				ptr++;
+				break;
+		}
+
+		if (count == LEEK_ADDRESS_LEN)
+			goto out;
+		pattern->masks[count++] = mask;
+	}
+
+	/* Trailing wildcards do not count in the pattern length */
+	for (unsigned int i = 0; i < LEEK_ADDRESS_LEN; ++i) {
+		if (i >= count)
+			pattern->masks[i] = LEEK_PATTERN_ANY;
+		if (pattern->masks[i] != LEEK_PATTERN_ANY)
+			pattern->length = i + 1;
+	}
+
+	if (!pattern->length)
+		goto out;
+
+	leek_pattern_finalize(pattern);
+	ret = 0;
+out:
+	return ret;
+}
+
+
+long double leek_pattern_proba(const struct leek_pattern *pattern)
+{
+	long double proba = 1;
+
+	for (unsigned int i = 0; i < pattern->length; ++i)
+		proba *= __builtin_popcount(pattern->masks[i]) / 32.0L;
+	return proba;
+}
+
+
+/* Bucket index holds the first 3 symbols and the high bit of the 4th one */
+unsigned int leek_pattern_index_match(const struct leek_pattern *pattern, uint16_t index)
+{
+	if ((index & pattern->index_mask) != pattern->index_value)
+		return 0;
+
+	for (unsigned int i = 0; i < 3; ++i) {
+		unsigned int symbol = (index >> (11 - LEEK_RAWADDR_CHAR_BITS * i)) & 0x1F;
+
+		if (!((pattern->masks[i] >> symbol) & 1))
+			return 0;
+	}
+
+	return !!(pattern->masks[3] & ((index & 1) ? 0xFFFF0000u : 0x0000FFFFu));
+}
@@ -0,0 +1,64 @@
+#ifndef __LEEK_PATTERN_H
+# define __LEEK_PATTERN_H
+# include <stdint.h>
+
+# include "helper.h"
+
+/* Symbols allowed at a position (bit 'n' is symbol 'n' of the base32 alphabet) */
+# define LEEK_PATTERN_ANY           0xFFFFFFFFu
+
+/* Pattern compiled from a string such as "shop[2-7]?x*" (see README):
+ *  - a literal symbol or '?' (any symbol),
+ *  - a class '[aeiou]', with ranges '[a-f2-4]' or negated '[^xyz]',
+ *  - '{n}' repeats the previous element n times,
+ *  - '*' is only allowed at the end (anything goes after the pattern). */
+struct leek_pattern {
+	uint32_t masks[LEEK_ADDRESS_LEN];
+
+	/* Positions with a single allowed symbol, checked all at once
+	 * (address bits as index and key, see leek_result_lookup) */
+	uint16_t index_mask;
+	uint16_t index_value;
+	uint64_t key_mask;
+	uint64_t key_value;
+
+	/* Positions holding a character class (one bit per position) */
+	uint16_t classes;
+
+	/* Position after the last constrained one (reported as match length) */
+	uint16_t length;
+};
+
+/* Compile a pattern string (returns -1 on syntax errors) */
+int leek_pattern_compile(struct leek_pattern *pattern, const char *source);
+
+/* Probability for a random address to match this pattern */
+long double leek_pattern_proba(const struct leek_pattern *pattern);
+
+/* Tells whether addresses with this bucket index may match the pattern */
+unsigned int leek_pattern_index_match(const struct leek_pattern *pattern, uint16_t index);
+
+
+/* Returns the pattern length when the address matches (or 0) */
+static inline unsigned int leek_pattern_match(const struct leek_pattern *pattern,
+                                              uint16_t index, uint64_t key)
+{
+	unsigned __int128 bits = ((unsigned __int128) index << 64) | key;
+
+	if (   ((index & pattern->index_mask) != pattern->index_value)
+	    || ((key & pattern->key_mask) != pattern->key_value))
+		return 0;
+
+	for (uint32_t classes = pattern->classes; classes; classes &= classes - 1) {
+		unsigned int i = __builtin_ctz(classes);
+		unsigned int shift = 8 * LEEK_RAWADDR_LEN - LEEK_RAWADDR_CHAR_BITS * (i + 1);
+		unsigned int symbol = (bits >> shift) & 0x1F;
+
+		if (!((pattern->masks[i] >> symbol) & 1))
+			return 0;
+	}
+
+	return pattern->length;
+}
+
+#endif /* !__LEEK_PATTERN_H */
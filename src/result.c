@@ -155,6 +155,12 @@ void leek_results_purge(void)
 		}
 	} while (item != head);
 
+	for (unsigned int j = 0; j < leek.terminal.board.count; ++j)
+		leek_result_free(leek.terminal.board.items[j]);
+	free(leek.terminal.board.items);
+	leek.terminal.board.items = NULL;
+	leek.terminal.board.count = 0;
+
 	pthread_mutex_unlock(&leek.terminal.ring.lock);
 }
 
@@ -201,6 +207,29 @@ void leek_result_new_display(bool verbose)
 }
 
 
+/* Leaderboard of partial matches (called with the ring lock held) */
+static void leek_result_board_display_locked(bool verbose)
+{
+	unsigned int count = leek.terminal.board.count;
+
+	printf("[+] Showing %u best partial matches\n", count);
+	for (unsigned int j = 0; j < count; ++j)
+		leek_result_display(leek.terminal.board.items[j], verbose);
+
+	if (count > 1)
+		printf("\n");
+}
+
+
+void leek_result_board_display(bool verbose)
+{
+	pthread_mutex_lock(&leek.terminal.ring.lock);
+	if (leek.terminal.board.count)
+		leek_result_board_display_locked(verbose);
+	pthread_mutex_unlock(&leek.terminal.ring.lock);
+}
+
+
 void leek_result_found_display(bool verbose)
 {
 	struct leek_result *head;
@@ -209,9 +238,9 @@ void leek_result_found_display(bool verbose)
 
 	pthread_mutex_lock(&leek.terminal.ring.lock);
 	count = leek.terminal.ring.count;
-	if (!count)
+	if (!count && !leek.terminal.board.count)
 		printf("[+] No result to display.\n\n");
-	else {
+	else if (count) {
 		printf("[+] Showing list of last %u items (%lu successes)\n",
 		       leek.terminal.ring.count, leek.stats.successes);
 		head = leek.terminal.ring.head;
@@ -227,6 +256,9 @@ void leek_result_found_display(bool verbose)
 		if (count > 1)
 			printf("\n");
 	}
+
+	if (leek.terminal.board.count)
+		leek_result_board_display_locked(verbose);
 	pthread_mutex_unlock(&leek.terminal.ring.lock);
 }
 
@@ -449,3 +481,158 @@ int leek_result_recheck(struct leek_rsa_item *item, unsigned int exponent,
 out:
 	return ret;
 }
+
+
+/* Private key as PEM (only for results that are kept) */
+static uint8_t *leek_result_pem(RSA *rsa, unsigned int *length)
+{
+	uint8_t *prv_output = NULL;
+	BUF_MEM *buffer;
+	BIO *bp;
+
+	bp = BIO_new(BIO_s_mem());
+	if (!bp)
+		goto out;
+
+	PEM_write_bio_RSAPrivateKey(bp, rsa, NULL, NULL, 0, NULL, NULL);
+	BIO_get_mem_ptr(bp, &buffer);
+
+	prv_output = malloc(buffer->length);
+	if (prv_output) {
+		memcpy(prv_output, buffer->data, buffer->length);
+		*length = buffer->length;
+	}
+
+	BIO_free(bp);
+out:
+	return prv_output;
+}
+
+
+/* Worker heaps are merged with the leaderboard under the ring lock,
+ * shorter items are evicted once the board is full. */
+static void leek_result_board_push(RSA *rsa, const struct leek_best *best)
+{
+	struct leek_result **items = leek.terminal.board.items;
+	struct leek_result *cleanup = NULL;
+	struct leek_result *result;
+	unsigned int count;
+	unsigned int j;
+
+	result = leek_result_alloc();
+	if (!result)
+		return;
+
+	result->prv_data = leek_result_pem(rsa, &result->prv_length);
+	if (!result->prv_data) {
+		leek_result_free(result);
+		return;
+	}
+
+	leek_base32_enc(result->address, best->addr.buffer);
+	result->address_length = best->length;
+	result->exponent = best->exponent;
+	result->flags = LEEK_RESULT_FLAG_DISPLAYED;
+
+	pthread_mutex_lock(&leek.terminal.ring.lock);
+	count = leek.terminal.board.count;
+
+	if (count == leek.options.best_count) {
+		/* Another worker got there first */
+		if (best->length <= items[count - 1]->address_length) {
+			cleanup = result;
+			goto unlock;
+		}
+		cleanup = items[--count];
+	}
+
+	/* Items of the same length are kept in arrival order */
+	for (j = count; j && items[j - 1]->address_length < best->length; --j)
+		items[j] = items[j - 1];
+	items[j] = result;
+	result->id = leek.terminal.board.total++;
+
+	leek.terminal.board.count = ++count;
+	if (count == leek.options.best_count)
+		leek.terminal.board.floor = items[count - 1]->address_length;
+
+unlock:
+	pthread_mutex_unlock(&leek.terminal.ring.lock);
+	leek_result_free(cleanup);
+}
+
+
+/* Min-heap on lengths (the shortest kept match is always first) */
+static void leek_result_best_sift(struct leek_best *heap, unsigned int count,
+                                  unsigned int i)
+{
+	while (1) {
+		unsigned int min = i;
+		unsigned int child = 2 * i + 1;
+		struct leek_best swap;
+
+		if (child < count && heap[child].length < heap[min].length)
+			min = child;
+		if (child + 1 < count && heap[child + 1].length < heap[min].length)
+			min = child + 1;
+		if (min == i)
+			break;
+
+		swap = heap[i];
+		heap[i] = heap[min];
+		heap[min] = swap;
+		i = min;
+	}
+}
+
+
+void leek_result_best_push(struct leek_worker *wk, const union leek_rawaddr *addr,
+                           uint32_t exponent, unsigned int length)
+{
+	struct leek_best *heap = wk->best;
+	unsigned int floor = leek.terminal.board.floor;
+	unsigned int i;
+
+	if (wk->best_count < leek.options.best_count) {
+		for (i = wk->best_count++; i && heap[(i - 1) / 2].length > length; i = (i - 1) / 2)
+			heap[i] = heap[(i - 1) / 2];
+	}
+	else if (length > heap[0].length)
+		i = 0;
+	else
+		return;
+
+	heap[i].addr = *addr;
+	heap[i].exponent = exponent;
+	heap[i].length = length;
+
+	if (wk->best_count == leek.options.best_count) {
+		leek_result_best_sift(heap, wk->best_count, i);
+		if (heap[0].length > floor)
+			floor = heap[0].length;
+	}
+
+	wk->best_floor = floor;
+}
+
+
+void leek_result_best_flush(struct leek_rsa_item *item, struct leek_worker *wk)
+{
+	for (unsigned int j = 0; j < wk->best_count; ++j) {
+		const struct leek_best *best = &wk->best[j];
+
+		/* This is read without lock, the board checks it again */
+		if (best->length <= leek.terminal.board.floor)
+			continue;
+
+		if (leek_result_recheck(item, best->exponent, &best->addr) < 0) {
+			__sync_add_and_fetch(&leek.stats.recheck_failures, 1);
+			continue;
+		}
+
+		leek_result_board_push(item->rsa, best);
+	}
+
+	wk->best_count = 0;
+	wk->best_floor = leek.terminal.board.floor;
+}
@@ -9,6 +9,7 @@
 
 /* Forward declaration */
 struct leek_result;
+struct leek_worker;
 
 /* Describes a single result item */
 struct leek_result {
@@ -27,6 +28,13 @@ struct leek_result {
 	unsigned int flags;                  /* See bellow */
 };
 
+/* Candidate sharing a long prefix with a loaded one (see --best) */
+struct leek_best {
+	union leek_rawaddr addr;             /* Raw address */
+	uint32_t exponent;                   /* Found exponent */
+	unsigned int length;                 /* Number of shared characters */
+};
+
 enum {
 	/* Whether this item has been displayed by the main thread */
 	LEEK_RESULT_FLAG_DISPLAYED    = (1 <<  0),
@@ -41,9 +49,19 @@ int leek_result_recheck(struct leek_rsa_item *item, uint32_t exponent,
 void leek_result_handle(RSA *rsa, uint32_t exponent, unsigned int length,
                         const union leek_rawaddr *addr);
 
+/* Keep a partial match in the worker best matches (see --best) */
+void leek_result_best_push(struct leek_worker *wk, const union leek_rawaddr *addr,
+                           uint32_t exponent, unsigned int length);
+
+/* Merge worker best matches on the leaderboard (before the item is destroyed) */
+void leek_result_best_flush(struct leek_rsa_item *item, struct leek_worker *wk);
+
 /* Show all items in queue */
 void leek_result_found_display(bool verbose);
 
+/* Show the leaderboard of best partial matches (see --best) */
+void leek_result_board_display(bool verbose);
+
 /* Show un-displayed results in the main thread */
 void leek_result_new_display(bool verbose);
 
@@ -5,14 +5,55 @@
 #include "leek.h"
 
 
+/* Loaded words of length 'i + 1' (they stand for all of their variants) */
+static uint64_t leek_stats_count(const struct leek_hashes *hashes, unsigned int i)
+{
+	return hashes->fold_count ? hashes->stats.variants[i] : hashes->stats.length[i];
+}
+
+
+/* Addresses start with a first and a second word, both of them short enough */
+static long double leek_stats_proba_second(const struct leek_hashes *second)
+{
+	long double proba_one = 0;
+
+	for (unsigned int i = leek.options.len_min - 1; i < leek.options.len_max; ++i) {
+		uint64_t count = leek_stats_count(&leek.hashes, i);
+
+		for (unsigned int j = 0; i + j + 2 <= LEEK_ADDRESS_LEN; ++j)
+			proba_one += (((long double) count * leek_stats_count(second, j))
+			              / powl(2, LEEK_RAWADDR_CHAR_BITS * (i + j + 2)));
+	}
+	return proba_one;
+}
+
+
 static long double leek_stats_proba_one(void)
 {
 	unsigned int len_min = leek.options.len_min;
 	unsigned int len_max = leek.options.len_max;
 	long double proba_one = 0;
 
+	/* Overlapping patterns are counted twice (this is an upper bound) */
+	if (leek.hashes.pattern_count) {
+		for (unsigned int j = 0; j < leek.hashes.pattern_count; ++j)
+			proba_one += leek_pattern_proba(&leek.hashes.patterns[j]);
+		return proba_one;
+	}
+
+	if (leek.hashes.second)
+		return leek_stats_proba_second(leek.hashes.second);
+
+	/* Substrings may start at any position (this is also an upper bound) */
 	for (unsigned int i = len_min - 1; i < len_max; ++i) {
-		proba_one += (((long double) leek.hashes.stats.length[i])
+		unsigned int positions = 1;
+		uint64_t count;
+
+		if (leek.options.flags & LEEK_OPTION_SUBSTRING)
+			positions = LEEK_ADDRESS_LEN - i;
+
+		count = leek_stats_count(&leek.hashes, i);
+		proba_one += (((long double) count * positions)
 		              / powl(2, LEEK_RAWADDR_CHAR_BITS * (i + 1)));
 	}
 	return proba_one;
@@ -108,6 +149,29 @@ void leek_stats_primes_display(void)
 }
 
 
+void leek_stats_filter_display(void)
+{
+	uint64_t passed = leek.hashes.filter.stats.passed;
+	uint64_t false_positives = leek.hashes.filter.stats.false_positives;
+	double hash_count = 0;
+	unsigned char a_unit;
+	unsigned char b_unit;
+	double a_value;
+	double b_value;
+
+	for (unsigned int i = 0; i < leek.workers.count; ++i)
+		hash_count += leek.workers.worker[i].stats.hash_count;
+
+	leek_stats_humanize_d(passed, &a_value, &a_unit, 1000);
+	leek_stats_humanize_d(false_positives, &b_value, &b_unit, 1000);
+
+	/* Nearly all hashes are filtered (buckets are all populated) */
+	printf("Prefilter.........: Pass:%5.1lf%c  False:%5.1lf%c    Rate:%7.3lf%%\n",
+	       a_value, a_unit, b_value, b_unit,
+	       hash_count ? 100.0 * false_positives / hash_count : 0.0);
+}
+
+
 static void leek_stats_worker_perf_get(struct leek_worker *wk,
                                        double *perf_hashcount, double *perf_hashrate)
 {
@@ -125,8 +189,8 @@ static void leek_stats_worker_perf_get(struct leek_worker *wk,
 }
 
 
-static void leek_stats_worker_perf_show(unsigned int wid, double perf_hashcount,
-                                        double perf_hashrate)
+static void leek_stats_worker_perf_show(unsigned int wid, const struct leek_worker *wk,
+                                        double perf_hashcount, double perf_hashrate)
 {
 	unsigned char c_unit;
 	unsigned char s_unit;
@@ -138,7 +202,11 @@ static void leek_stats_worker_perf_show(unsigned int wid, double perf_hashcount,
 	leek_stats_humanize_d(perf_hashcount, &c_value, &c_unit, 1000);
 	leek_stats_humanize_d(perf_hashrate, &s_value, &s_unit, 1000);
 
-	printf("Hashs:%5.1lf%c  Rate:%5.1lf%cH/s\n", c_value, c_unit, s_value, s_unit);
+	printf("Hashs:%5.1lf%c  Rate:%5.1lf%cH/s  Impl:%s", c_value, c_unit, s_value, s_unit,
+	       wk->impl->name);
+	if (wk->cpu >= 0)
+		printf(" (cpu %d)", wk->cpu);
+	printf("\n");
 }
 
 
@@ -168,7 +236,8 @@ void leek_stats_perf_display(bool individual)
 	double total_hashcount = 0;
 	double total_hashrate = 0;
 
-	if (count < 2)
+	/* Always show individual rates when implementations are mixed */
+	if (count < 2 || leek.options.placement == LEEK_PLACEMENT_MIXED)
 		individual = true;
 
 	for (unsigned int i = 0; i < count; ++i) {
@@ -183,7 +252,7 @@ void leek_stats_perf_display(bool individual)
 			total_hashrate += perf_hashrate;
 
 			if (individual)
-				leek_stats_worker_perf_show(i, perf_hashcount, perf_hashrate);
+				leek_stats_worker_perf_show(i, wk, perf_hashcount, perf_hashrate);
 		}
 	}
 
@@ -196,8 +265,11 @@ void leek_status_display(bool verbose)
 	printf("[+] Current %sstatus:\n", (verbose) ? "detailled " : "");
 	leek_stats_application_display();
 
-	if (verbose)
+	if (verbose) {
 		leek_stats_primes_display();
+		if (leek.hashes.filter.fingerprints)
+			leek_stats_filter_display();
+	}
 
   leek_stats_perf_display(verbose);
 	printf("\n");
@@ -26,6 +26,7 @@ enum {
 void leek_stats_application_display(void);
 void leek_stats_perf_display(bool individual);
 void leek_stats_primes_display(void);
+void leek_stats_filter_display(void);
 
 /* Show all statuses listed above */
 void leek_status_display(bool verbose);
@@ -1,5 +1,6 @@
 #include <errno.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <stdbool.h>
 #include <string.h>
 #include <signal.h>
@@ -69,7 +70,7 @@ static void leek_terminal_prompt_show(void)
 	if (leek.terminal.flags & LEEK_TERMINAL_IS_TTY) {
 		length += printf("[h]elp [s]tatus ");
 
-		if (leek.stats.successes)
+		if (leek.stats.successes || leek.terminal.board.count)
 			length += printf("[f]ound ");
 		length += printf("[q]uit => ");
 	}
@@ -91,7 +92,7 @@ static void leek_terminal_prompt_clear(void)
 static void leek_terminal_usage_display(void)
 {
 	printf("[+] Terminal usage:\n");
-	printf("> f   show last results.\n");
+	printf("> f   show last results (and best partial matches).\n");
 	printf("> F   show last results with detailed keys.\n");
 	printf("> s   show attack status summary.\n");
 	printf("> S   show detailed attack status.\n");
@@ -549,6 +550,16 @@ int leek_events_init(void)
 	leek.terminal.ring.count = 0;
 	leek.terminal.flags = 0;
 
+	if (leek.options.flags & LEEK_OPTION_BEST) {
+		leek.terminal.board.items = calloc(leek.options.best_count,
+		                                   sizeof(*leek.terminal.board.items));
+		if (!leek.terminal.board.items) {
+			fprintf(stderr, "error: calloc: %s\n", strerror(errno));
+			ret = -1;
+			goto out;
+		}
+	}
+
 	ret = eventfd(0, EFD_NONBLOCK);
 	if (ret < 0)
 		goto out;
@@ -582,6 +593,9 @@ void leek_events_exit(void)
 {
 	/* Check for late results to display here... */
 	leek_events_late_handle();
+
+	/* Workers merged their last partial matches when stopping */
+	leek_result_board_display(!!(leek.options.flags & LEEK_OPTION_VERBOSE));
 	leek_results_purge();
 
 	if (leek.terminal.efd >= 0)
@@ -18,6 +18,15 @@ struct leek_terminal {
 		unsigned int count;         /* Current number of items */
 		pthread_mutex_t lock;       /* Locks operations on the ring */
 	} ring;
+
+	/* Best partial matches of all workers, longest first (see --best)
+	 * This is also protected by the ring lock */
+	struct {
+		struct leek_result **items;
+		unsigned int count;         /* Current number of items */
+		unsigned int floor;         /* Length to beat once full */
+		unsigned int total;         /* Number of items ever kept */
+	} board;
 };
 
 enum {
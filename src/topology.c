@@ -0,0 +1,160 @@
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/sysinfo.h>
+
+#include "leek.h"
+
+
+/* Read the first CPU listed in a sysfs cpulist file (e.g. "0-1" or "0,4") */
+static int leek_topology_first(unsigned int cpu, const char *name)
+{
+	char path[128];
+	unsigned int first;
+	int ret = -1;
+	FILE *fp;
+
+	snprintf(path, sizeof(path), LEEK_TOPOLOGY_SYSFS "/cpu%u/topology/%s", cpu, name);
+
+	fp = fopen(path, "r");
+	if (!fp)
+		goto out;
+
+	if (fscanf(fp, "%u", &first) == 1)
+		ret = first;
+
+	fclose(fp);
+out:
+	return ret;
+}
+
+
+/* NUMA node of a CPU (its sysfs directory holds a "nodeX" link) */
+static unsigned int leek_topology_node(unsigned int cpu)
+{
+	char path[128];
+	unsigned int node = 0;
+	struct dirent *entry;
+	DIR *dir;
+
+	snprintf(path, sizeof(path), LEEK_TOPOLOGY_SYSFS "/cpu%u", cpu);
+
+	dir = opendir(path);
+	if (!dir)
+		goto out;
+
+	while ((entry = readdir(dir))) {
+		if (sscanf(entry->d_name, "node%u", &node) == 1)
+			break;
+	}
+
+	closedir(dir);
+out:
+	return node;
+}
+
+
+int leek_topology_init(void)
+{
+	unsigned int cpu_count = get_nprocs_conf();
+	struct leek_topology_cpu *cpus;
+	unsigned int logical = 0;
+	unsigned int physical = 0;
+	int ret = -1;
+
+	cpus = calloc(cpu_count, sizeof(*cpus));
+	if (!cpus) {
+		fprintf(stderr, "error: unable to allocate topology structure.\n");
+		goto out;
+	}
+
+	for (unsigned int cpu = 0; cpu < cpu_count; ++cpu) {
+		int first;
+
+		/* Offline CPUs have no topology directory */
+		first = leek_topology_first(cpu, "thread_siblings_list");
+		if (first < 0)
+			continue;
+
+		cpus[logical].id = cpu;
+		cpus[logical].core = first;
+		cpus[logical].node = leek_topology_node(cpu);
+
+		/* Siblings are listed in order, count the previous ones */
+		for (unsigned int i = 0; i < logical; ++i) {
+			if (cpus[i].core == cpus[logical].core)
+				cpus[logical].thread++;
+		}
+
+		if (!cpus[logical].thread)
+			physical++;
+		logical++;
+	}
+
+	if (!logical) {
+		free(cpus);
+		cpus = NULL;
+		logical = get_nprocs();
+		physical = logical;
+	}
+
+	leek.topology.logical = logical;
+	leek.topology.physical = physical;
+	leek.topology.cpus = cpus;
+	leek.topology.nodes = 1;
+
+	for (unsigned int i = 0; cpus && i < logical; ++i) {
+		if (cpus[i].node >= leek.topology.nodes)
+			leek.topology.nodes = cpus[i].node + 1;
+	}
+
+	/* Fake nodes split physical cores (SMT siblings stay together),
+	 * some nodes may have no CPU at all on small machines */
+	if (cpus && leek.options.numa_nodes) {
+		for (unsigned int i = 0; i < logical; ++i)
+			cpus[i].node = cpus[i].core % leek.options.numa_nodes;
+		leek.topology.nodes = leek.options.numa_nodes;
+	}
+
+	ret = 0;
+out:
+	return ret;
+}
+
+
+void leek_topology_exit(void)
+{
+	free(leek.topology.cpus);
+	leek.topology.cpus = NULL;
+}
+
+
+static int leek_topology_cmp_spread(const void *a, const void *b)
+{
+	const struct leek_topology_cpu *ca = a;
+	const struct leek_topology_cpu *cb = b;
+
+	if (ca->thread != cb->thread)
+		return (ca->thread < cb->thread) ? -1 : 1;
+	return (ca->id < cb->id) ? -1 : (ca->id > cb->id);
+}
+
+static int leek_topology_cmp_pairs(const void *a, const void *b)
+{
+	const struct leek_topology_cpu *ca = a;
+	const struct leek_topology_cpu *cb = b;
+
+	if (ca->core != cb->core)
+		return (ca->core < cb->core) ? -1 : 1;
+	return (ca->thread < cb->thread) ? -1 : (ca->thread > cb->thread);
+}
+
+
+void leek_topology_sort(bool spread)
+{
+	if (!leek.topology.cpus)
+		return;
+
+	qsort(leek.topology.cpus, leek.topology.logical, sizeof(*leek.topology.cpus),
+	      (spread) ? leek_topology_cmp_spread : leek_topology_cmp_pairs);
+}
@@ -0,0 +1,35 @@
+#ifndef __LEEK_TOPOLOGY_H
+# define __LEEK_TOPOLOGY_H
+# include <stdbool.h>
+
+# define LEEK_TOPOLOGY_SYSFS  "/sys/devices/system/cpu"
+
+/* A single online logical CPU */
+struct leek_topology_cpu {
+	unsigned int id;        /* Logical CPU identifier */
+	unsigned int core;      /* First logical CPU of the same physical core */
+	unsigned int thread;    /* SMT thread index in this physical core */
+	unsigned int node;      /* NUMA node */
+};
+
+/* Processor topology (as seen from sysfs) */
+struct leek_topology {
+	unsigned int logical;   /* Online logical CPUs */
+	unsigned int physical;  /* Physical cores (logical CPUs without SMT) */
+	unsigned int nodes;     /* NUMA nodes (1 when sysfs is unavailable) */
+
+	/* All online logical CPUs (NULL when sysfs is unavailable) */
+	struct leek_topology_cpu *cpus;
+};
+
+/* Read processor topology (falls back to no SMT when sysfs is unavailable) */
+int leek_topology_init(void);
+
+/* Free memory allocated by leek_topology_init */
+void leek_topology_exit(void);
+
+/* Sort CPUs for worker placement: one thread per physical core first when
+ * 'spread' is set, else all SMT siblings of a physical core are adjacent. */
+void leek_topology_sort(bool spread);
+
+#endif /* !__LEEK_TOPOLOGY_H */
@@ -0,0 +1,440 @@
+#include <endian.h>
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#include "leek.h"
+
+/* Size of a DER encoded 1024b RSA public key with a 4 bytes exponent */
+#define LEEK_TUNE_DER_SIZE  141
+#define LEEK_TUNE_LINE_MAX  256
+
+
+/* Benchmark context for a single thread */
+struct leek_tune_run {
+	const struct leek_implementation *impl;
+	struct leek_rsa_item item;
+	struct leek_worker wk;
+};
+
+
+/* Fill in a DER structure with a pseudo-random modulus (never checked) */
+static void leek_tune_der_build(uint8_t *der)
+{
+	static const uint8_t header[] = { 0x30, 0x81, 0x8a, 0x02, 0x81, 0x81, 0x00 };
+	uint32_t e_be = htobe32(LEEK_RSA_E_START);
+	uint32_t x = 0x9e3779b9;
+	size_t pos = 0;
+
+	memcpy(der, header, sizeof(header));
+	pos += sizeof(header);
+
+	for (unsigned int i = 0; i < LEEK_RSA_KEYSIZE / 8; ++i) {
+		x ^= x << 13;
+		x ^= x >> 17;
+		x ^= x << 5;
+		der[pos++] = x;
+	}
+	der[sizeof(header)] |= 0x80;
+
+	der[pos++] = 0x02;
+	der[pos++] = LEEK_RSA_E_SIZE;
+	memcpy(&der[pos], &e_be, sizeof(e_be));
+}
+
+
+static void leek_tune_cpu_model(char *model, size_t size)
+{
+	char line[LEEK_TUNE_LINE_MAX];
+	FILE *fp;
+
+	snprintf(model, size, "unknown");
+
+	fp = fopen("/proc/cpuinfo", "r");
+	if (!fp)
+		return;
+
+	while (fgets(line, sizeof(line), fp)) {
+		char *ptr;
+
+		if (strncmp(line, "model name", 10))
+			continue;
+
+		ptr = strchr(line, ':');
+		if (!ptr)
+			continue;
+
+		ptr += strspn(ptr + 1, " \t") + 1;
+		ptr[strcspn(ptr, "\t\n")] = 0;
+		snprintf(model, size, "%s", ptr);
+		break;
+	}
+
+	fclose(fp);
+}
+
+
+/* Cache path is $XDG_CACHE_HOME/leek/tune (or $HOME/.cache/leek/tune) */
+static int leek_tune_cache_path(char *path, size_t size, bool create)
+{
+	const char *base = getenv("XDG_CACHE_HOME");
+	const char *home = getenv("HOME");
+	int ret = -1;
+
+	if (base && *base)
+		snprintf(path, size, "%s", base);
+	else if (home && *home)
+		snprintf(path, size, "%s/.cache", home);
+	else
+		goto out;
+
+	if (create && mkdir(path, 0700) < 0 && errno != EEXIST)
+		goto out;
+
+	strncat(path, "/" LEEK_TUNE_CACHE_DIR, size - strlen(path) - 1);
+	if (create && mkdir(path, 0700) < 0 && errno != EEXIST)
+		goto out;
+
+	strncat(path, "/" LEEK_TUNE_CACHE_FILE, size - strlen(path) - 1);
+	ret = 0;
+out:
+	return ret;
+}
+
+
+/* Cache lines are "<cpu model>\t<implementation>\t<variant>" */
+static int leek_tune_cache_load(const struct leek_implementation *impl,
+                                const char *model, unsigned int *variant)
+{
+	char line[LEEK_TUNE_LINE_MAX];
+	char path[PATH_MAX];
+	int ret = -1;
+	FILE *fp;
+
+	if (leek_tune_cache_path(path, sizeof(path), false) < 0)
+		goto out;
+
+	fp = fopen(path, "r");
+	if (!fp)
+		goto out;
+
+	while (ret < 0 && fgets(line, sizeof(line), fp)) {
+		char *name = strchr(line, '\t');
+		char *vname;
+
+		if (!name)
+			continue;
+		*name++ = 0;
+
+		vname = strchr(name, '\t');
+		if (!vname)
+			continue;
+		*vname++ = 0;
+		vname[strcspn(vname, "\n")] = 0;
+
+		if (strcmp(line, model) || strcmp(name, impl->name))
+			continue;
+
+		for (unsigned int i = 0; impl->variants[i]; ++i) {
+			if (!strcmp(impl->variants[i], vname)) {
+				*variant = i;
+				ret = 0;
+				break;
+			}
+		}
+	}
+
+	fclose(fp);
+out:
+	return ret;
+}
+
+static void leek_tune_cache_save(const struct leek_implementation *impl,
+                                 const char *model, unsigned int variant)
+{
+	char prefix[LEEK_TUNE_LINE_MAX];
+	char line[LEEK_TUNE_LINE_MAX];
+	char path[PATH_MAX];
+	char *data = NULL;
+	size_t data_len = 0;
+	size_t prefix_len;
+	FILE *fp;
+
+	if (leek_tune_cache_path(path, sizeof(path), true) < 0) {
+		fprintf(stderr, "warning: unable to create tune cache directory.\n");
+		return;
+	}
+
+	/* Keep all other entries from the current file */
+	prefix_len = snprintf(prefix, sizeof(prefix), "%s\t%s\t", model, impl->name);
+	fp = fopen(path, "r");
+	if (fp) {
+		while (fgets(line, sizeof(line), fp)) {
+			size_t len = strlen(line);
+			char *ndata;
+
+			if (!strncmp(line, prefix, prefix_len))
+				continue;
+
+			ndata = realloc(data, data_len + len);
+			if (!ndata)
+				break;
+			data = ndata;
+			memcpy(data + data_len, line, len);
+			data_len += len;
+		}
+		fclose(fp);
+	}
+
+	fp = fopen(path, "w");
+	if (!fp) {
+		fprintf(stderr, "warning: fopen: %s: %s\n", path, strerror(errno));
+		goto out;
+	}
+
+	if (data_len)
+		fwrite(data, 1, data_len, fp);
+	fprintf(fp, "%s\t%s\t%s\n", model, impl->name, impl->variants[variant]);
+	fclose(fp);
+
+out:
+	free(data);
+}
+
+
+static void *leek_tune_worker(void *arg)
+{
+	struct leek_tune_run *run = arg;
+	int ret;
+
+	run->wk.stats.ts_start = leek_timestamp();
+	ret = run->impl->exhaust(&run->item, &run->wk);
+	run->wk.stats.ts_stop = leek_timestamp();
+
+	return (ret < 0) ? PTHREAD_CANCELED : NULL;
+}
+
+/* Run 'threads' exhaust loops at the same time for 'duration' msecs
+ * and return the aggregated hash rate (in hashes per second, 0 on error). */
+static double leek_tune_measure(const struct leek_implementation *impl,
+                                const uint8_t *der, unsigned int threads,
+                                unsigned int duration)
+{
+	const struct timespec delay = {
+		.tv_sec  = duration / 1000,
+		.tv_nsec = (duration % 1000) * 1000000L,
+	};
+	struct leek_tune_run *runs;
+	unsigned int started = 0;
+	bool failed = false;
+	double rate = 0.;
+	int ret;
+
+	runs = calloc(threads, sizeof(*runs));
+	if (!runs)
+		goto out;
+
+	/* Synthetic items without any RSA key (matches are ignored) */
+	for (unsigned int i = 0; i < threads; ++i) {
+		runs[i].impl = impl;
+		runs[i].wk.hashes = &leek.hashes;
+		runs[i].item.private_data = impl->allocate();
+		if (!runs[i].item.private_data)
+			goto cleanup;
+
+		ret = impl->precalc(&runs[i].item, der, LEEK_TUNE_DER_SIZE);
+		if (ret < 0)
+			goto cleanup;
+	}
+
+	for (started = 0; started < threads; ++started) {
+		ret = pthread_create(&runs[started].wk.thread, NULL, leek_tune_worker, &runs[started]);
+		if (ret) {
+			fprintf(stderr, "error: pthread_create: %s\n", strerror(ret));
+			break;
+		}
+	}
+
+	if (started == threads)
+		nanosleep(&delay, NULL);
+
+	for (unsigned int i = 0; i < started; ++i)
+		__sync_fetch_and_or(&runs[i].wk.flags, LEEK_WORKER_FLAG_EXITING);
+
+	for (unsigned int i = 0; i < started; ++i) {
+		struct leek_worker *wk = &runs[i].wk;
+		void *retp;
+
+		pthread_join(wk->thread, &retp);
+		if (retp || wk->stats.ts_stop <= wk->stats.ts_start)
+			failed = true;
+		else
+			rate += 1000000. * wk->stats.hash_count / (wk->stats.ts_stop - wk->stats.ts_start);
+	}
+
+	/* Partial measures are meaningless */
+	if (failed || started != threads)
+		rate = 0.;
+
+cleanup:
+	for (unsigned int i = 0; i < threads; ++i) {
+		if (!runs[i].item.private_data)
+			continue;
+		if (impl->cleanup)
+			impl->cleanup(runs[i].item.private_data);
+		else
+			free(runs[i].item.private_data);
+	}
+	free(runs);
+out:
+	return rate;
+}
+
+
+static int leek_tune_implementation(const struct leek_implementation *impl)
+{
+	uint8_t der[LEEK_TUNE_DER_SIZE];
+	unsigned int variant = 0;
+	char model[LEEK_TUNE_LINE_MAX];
+	double best_rate = 0.;
+	int ret = 0;
+
+	/* Nothing to choose from with this implementation */
+	if (!impl->variants || !impl->variants[0] || !impl->variants[1])
+		goto out;
+
+	leek_tune_cpu_model(model, sizeof(model));
+
+	if (!leek_tune_cache_load(impl, model, &variant)) {
+		impl->variant_set(variant);
+		printf("[+] Using %s kernel variant %s (cached).\n",
+		       impl->name, impl->variants[variant]);
+		goto out;
+	}
+
+	printf("[+] Tuning %s kernel variants, please wait...\n", impl->name);
+	leek_tune_der_build(der);
+
+	for (unsigned int i = 0; impl->variants[i]; ++i) {
+		double rate;
+
+		impl->variant_set(i);
+		rate = leek_tune_measure(impl, der, 1, LEEK_TUNE_DURATION);
+
+		if (leek.options.flags & LEEK_OPTION_VERBOSE)
+			printf("[+]   %-10s %8.2f MH/s\n", impl->variants[i], rate / 1000000.);
+
+		if (rate > best_rate) {
+			best_rate = rate;
+			variant = i;
+		}
+	}
+
+	if (best_rate == 0.) {
+		fprintf(stderr, "error: unable to run any %s kernel variant.\n", impl->name);
+		ret = -1;
+		goto out;
+	}
+
+	impl->variant_set(variant);
+	leek_tune_cache_save(impl, model, variant);
+
+	printf("[+] Using %s kernel variant %s (%.2f MH/s).\n",
+	       impl->name, impl->variants[variant], best_rate / 1000000.);
+
+out:
+	return ret;
+}
+
+
+int leek_tune(void)
+{
+	int ret;
+
+	ret = leek_tune_implementation(leek.implementation);
+	if (ret < 0)
+		goto out;
+
+	/* Sibling implementation is tuned alone (not next to its pair) */
+	if (   leek.options.placement == LEEK_PLACEMENT_MIXED
+	    && leek.sibling_implementation != leek.implementation)
+		ret = leek_tune_implementation(leek.sibling_implementation);
+
+out:
+	return ret;
+}
+
+
+int leek_tune_auto(void)
+{
+	const unsigned int logical = leek.topology.logical;
+	const unsigned int physical = leek.topology.physical;
+	const struct leek_implementation *best_impl = NULL;
+	unsigned int best_threads = 0;
+	unsigned int counts[3];
+	unsigned int count_nr = 0;
+	uint8_t der[LEEK_TUNE_DER_SIZE];
+	double best_rate = 0.;
+	int ret = -1;
+
+	/* All logical CPUs, physical cores only, physical cores + half of the siblings */
+	counts[count_nr++] = logical;
+	if (physical < logical) {
+		counts[count_nr++] = physical;
+		if ((logical - physical) / 2)
+			counts[count_nr++] = physical + (logical - physical) / 2;
+	}
+
+	printf("[+] Calibrating implementations on %u logical CPUs (%u physical cores).\n",
+	       logical, physical);
+	printf("[+]   %-10s %8s %12s\n", "Impl.", "Threads", "Rate");
+	leek_tune_der_build(der);
+
+	for (int i = 0; leek_implementations[i]; ++i) {
+		const struct leek_implementation *impl = leek_implementations[i];
+
+		if (!impl->available())
+			continue;
+
+		/* Only calibrate thread counts when the implementation was forced */
+		if (leek.options.implementation && impl != leek.implementation)
+			continue;
+
+		for (unsigned int c = 0; c < count_nr; ++c) {
+			unsigned int threads = counts[c];
+			double rate;
+
+			if (threads > LEEK_THREADS_MAX)
+				threads = LEEK_THREADS_MAX;
+
+			rate = leek_tune_measure(impl, der, threads, LEEK_TUNE_AUTO_DURATION);
+			printf("[+]   %-10s %8u %7.2f MH/s\n", impl->name, threads, rate / 1000000.);
+
+			if (rate > best_rate) {
+				best_impl = impl;
+				best_threads = threads;
+				best_rate = rate;
+			}
+		}
+	}
+
+	if (!best_impl) {
+		fprintf(stderr, "error: unable to calibrate any implementation.\n");
+		goto out;
+	}
+
+	leek.implementation = best_impl;
+	leek.options.threads = best_threads;
+
+	printf("[+] Selected %s implementation on %u worker threads (%.2f MH/s).\n",
+	       best_impl->name, best_threads, best_rate / 1000000.);
+
+	ret = 0;
+out:
+	return ret;
+}
@@ -0,0 +1,22 @@
+#ifndef __LEEK_TUNE_H
+# define __LEEK_TUNE_H
+
+/* Time spent on each exhaust kernel variant during autotune */
+# define LEEK_TUNE_DURATION          200 /* msecs */
+
+/* Time spent on each implementation and thread count with --auto */
+# define LEEK_TUNE_AUTO_DURATION     300 /* msecs */
+
+/* Cache file location (relative to $XDG_CACHE_HOME or $HOME/.cache) */
+# define LEEK_TUNE_CACHE_DIR        "leek"
+# define LEEK_TUNE_CACHE_FILE       "tune"
+
+/* Select the fastest kernel variant of the chosen implementation
+ * (from the cache file when this CPU model was already calibrated). */
+int leek_tune(void);
+
+/* Select the implementation and thread count with the highest aggregated
+ * hash rate (measured using default kernel variants). */
+int leek_tune_auto(void);
+
+#endif /* !__LEEK_TUNE_H */
@@ -14,19 +14,23 @@ static int leek_vecx_available(void)
 	return __builtin_cpu_supports(VECX_IMPL_ISA);
 }
 
+/* Hot worker data is prefaulted (and locked with --mlock) */
 static void *leek_vecx_alloc(void)
 {
 	struct leek_vecx *lv;
 
-	lv = aligned_alloc(LEEK_CACHELINE_SZ, sizeof(*lv));
-	if (!lv)
-		goto out;
-	memset(lv, 0, sizeof(*lv));
+	/* Regions are cache line aligned, as required by wide vector types */
+	_Static_assert(__alignof__(*lv) <= LEEK_CACHELINE_SZ, "unsupported vector alignment");
 
-out:
+	lv = leek_region_alloc(sizeof(*lv));
 	return lv;
 }
 
+static void leek_vecx_cleanup(void *private_data)
+{
+	leek_region_free(private_data);
+}
+
 static void leek_vecx_reset(struct leek_vecx *lv)
 {
 	lv->H[0] = vecx_set(VEC_SHA1_H0);
@@ -144,177 +148,212 @@ static void leek_vecx_update(struct leek_vecx *lv)
 static void leek_exhaust_precalc_1(struct leek_vecx *lv)
 {
 	const vecx *in = (const vecx *) lv->block;
-	vecx a, b, c, d, e;
-	vecx W[2];
+	vecx a[1], b[1], c[1], d[1], e[1];
+	vecx W[2][1];
 
-	a = lv->H[0];
-	b = lv->H[1];
-	c = lv->H[2];
-	d = lv->H[3];
-	e = lv->H[4];
+	a[0] = lv->H[0];
+	b[0] = lv->H[1];
+	c[0] = lv->H[2];
+	d[0] = lv->H[3];
+	e[0] = lv->H[4];
 
 	/* Pre-compute the first few rounds here (static data) */
-	vecx_ROUND_O(vecx_F1, vecx_SRC,  0, a, b, c, d, e, VEC_SHA1_K1);
-	vecx_ROUND_O(vecx_F1, vecx_SRC,  1, e, a, b, c, d, VEC_SHA1_K1);
+	vecx_ROUND_O(0, vecx_F1, vecx_SRS,  0, a, b, c, d, e, VEC_SHA1_K1);
+	vecx_ROUND_O(0, vecx_F1, vecx_SRS,  1, e, a, b, c, d, VEC_SHA1_K1);
 
 	/* This is partial pre-calculus for round 2 */
-	vecx_ROUND_E(vecx_F1,            2, d, e, a, b, c, VEC_SHA1_K1);
+	vecx_ROUND_E(0, vecx_F1,            2, d, e, a, b, c, VEC_SHA1_K1);
 
 	/* This is very partial pre-calculus or round 3 */
-	lv->PA_C03 = vecx_add3(b, vecx_F1(d, e, a), vecx_set(VEC_SHA1_K1));
-	d = vecx_ror(d, 2);
+	lv->PA_C03 = vecx_add3(b[0], vecx_F1(d[0], e[0], a[0]), vecx_set(VEC_SHA1_K1));
+	d[0] = vecx_ror(d[0], 2);
 
 	/* Store our current state(s) */
-	lv->PW_C00 = W[0];         /* 1st static word */
-	lv->PW_C01 = W[1];         /* 2nd static word */
+	lv->PW_C00 = W[0][0];      /* 1st static word */
+	lv->PW_C01 = W[1][0];      /* 2nd static word */
 
 	lv->PW_C15 = vecx_SRC(15);
 
-	lv->PH[0] = a;
-	lv->PH[1] = b;
-	lv->PH[2] = c;
-	lv->PH[3] = d;
-	lv->PH[4] = e;
+	lv->PH[0] = a[0];
+	lv->PH[1] = b[0];
+	lv->PH[2] = c[0];
+	lv->PH[3] = d[0];
+	lv->PH[4] = e[0];
 }
 
 
-static void leek_exhaust_precalc_2(struct leek_vecx *lv, vecx vexpo_1)
+/* Message schedule is GF(2)-linear: W[16..79] = L(W[0..15]).
+ * Only W[2] and W[3] vary, so the expanded words are split in two parts:
+ *  - L(W[0..15] with W[2] = 0) is computed once per W[3] (stage 2),
+ *  - L(W[2] alone) is lane-uniform and computed once for "VECTOR_LANES"
+ *    consecutive values of W[2], in a single vector (stage 3).
+ * The finalize loop then only XORs both parts for each expanded word. */
+static void leek_exhaust_expand(vecx *out, size_t stride, vecx W[16])
 {
-	lv->PW_C03 = vexpo_1;
+	for (int x = VEC_SHA1_LBLOCK_SIZE; x < 80; ++x) {
+		vecx_W(x) = vecx_MIX(x);
+		out[stride * (x - VEC_SHA1_LBLOCK_SIZE)] = vecx_W(x);
+	}
+}
+
+/* Stage2: per W[3] values ('linear' when the finalize variant needs them) */
+static void leek_exhaust_precalc_2(struct leek_vecx *lv, vecx vexpo_1, int linear)
+{
+	for (int t = 0; t < VECX_STREAM_COUNT; ++t) {
+		vecx W[16];
+
+		lv->PW_C03[t] = vexpo_1;
 
-	/* Enhance pre-compute for cycle 3 (here we have temporary value for 'b') */
-	lv->PH[1] = vecx_add(lv->PA_C03, vexpo_1);
+		/* Enhance pre-compute for cycle 3 (here we have temporary value for 'b') */
+		lv->PB_C03[t] = vecx_add(lv->PA_C03, vexpo_1);
+
+		if (linear) {
+			/* Static part of the expanded words (W[2] is zero here) */
+			for (int x = 0; x < 16; ++x)
+				W[x] = vecx_zero();
+			W[0]  = lv->PW_C00;
+			W[1]  = lv->PW_C01;
+			W[3]  = vexpo_1;
+			W[15] = lv->PW_C15;
+
+			leek_exhaust_expand(&lv->PW_L[0][t], VECX_STREAM_COUNT, W);
+		}
+
+		vexpo_1 = vecx_add(vexpo_1, lv->vstream);
+	}
 }
 
 
-/* Customized hash function (final block) */
-static void leek_vecx_finalize(struct leek_vecx *lv, vecx vexpo_0)
+/* Stage3: W[2] part of the expanded words for the next consecutive values */
+static void leek_exhaust_precalc_3(struct leek_vecx *lv, vecx vexpo_0)
 {
-	uint8_t *bufout = lv->R[0].data;
-	vecx a, b, c, d, e;
-	/* 80 rounds minus the 3 finals */
-	vecx W[77];
-
-	a = lv->PH[0];
-	b = lv->PH[1];
-	c = lv->PH[2];
-	d = lv->PH[3];
-	e = lv->PH[4];
-
-	/* Load pre-computed data */
-	W[0]  = lv->PW_C00;
-	W[1]  = lv->PW_C01;
-	W[2]  = vexpo_0;
-	W[3]  = lv->PW_C03;
-	W[15] = lv->PW_C15;
-
-	/* This finishes round 2 gracefully */
-	c = vecx_add(c, vexpo_0);
-
-	/* This finishes round 3 gracefully as well */
-	b = vecx_add(vecx_rol(c, 5), b);
-
-	/* We choose not to pre-compute words for rounds 17, 20 and 23
-	 * because benchmarks showed a performance regression probably due
-	 * to memory loading. Over-optimization is not worth here. */
-
-	vecx_ROUND_E(vecx_F1,            4, b, c, d, e, a, VEC_SHA1_K1);
-	vecx_ROUND_E(vecx_F1,            5, a, b, c, d, e, VEC_SHA1_K1);
-	vecx_ROUND_E(vecx_F1,            6, e, a, b, c, d, VEC_SHA1_K1);
-	vecx_ROUND_E(vecx_F1,            7, d, e, a, b, c, VEC_SHA1_K1);
-	vecx_ROUND_E(vecx_F1,            8, c, d, e, a, b, VEC_SHA1_K1);
-	vecx_ROUND_E(vecx_F1,            9, b, c, d, e, a, VEC_SHA1_K1);
-	vecx_ROUND_E(vecx_F1,           10, a, b, c, d, e, VEC_SHA1_K1);
-	vecx_ROUND_E(vecx_F1,           11, e, a, b, c, d, VEC_SHA1_K1);
-	vecx_ROUND_E(vecx_F1,           12, d, e, a, b, c, VEC_SHA1_K1);
-	vecx_ROUND_E(vecx_F1,           13, c, d, e, a, b, VEC_SHA1_K1);
-	vecx_ROUND_E(vecx_F1,           14, b, c, d, e, a, VEC_SHA1_K1);
-	vecx_ROUND_F(vecx_F1, vecx_LDW, 15, a, b, c, d, e, VEC_SHA1_K1);
-
-	vecx_ROUND_O(vecx_F1, vecx_MXC, 16, e, a, b, c, d, VEC_SHA1_K1);
-	vecx_ROUND_O(vecx_F1, vecx_MXC, 17, d, e, a, b, c, VEC_SHA1_K1);
-	vecx_ROUND_O(vecx_F1, vecx_MX9, 18, c, d, e, a, b, VEC_SHA1_K1);
-	vecx_ROUND_O(vecx_F1, vecx_MX9, 19, b, c, d, e, a, VEC_SHA1_K1);
-
-	vecx_ROUND_O(vecx_F2, vecx_MX1, 20, a, b, c, d, e, VEC_SHA1_K2);
-	vecx_ROUND_O(vecx_F2, vecx_MX1, 21, e, a, b, c, d, VEC_SHA1_K2);
-	vecx_ROUND_O(vecx_F2, vecx_MX1, 22, d, e, a, b, c, VEC_SHA1_K2);
-	vecx_ROUND_O(vecx_F2, vecx_MX3, 23, c, d, e, a, b, VEC_SHA1_K2);
-	vecx_ROUND_O(vecx_F2, vecx_MX3, 24, b, c, d, e, a, VEC_SHA1_K2);
-	vecx_ROUND_O(vecx_F2, vecx_MX3, 25, a, b, c, d, e, VEC_SHA1_K2);
-	vecx_ROUND_O(vecx_F2, vecx_MX3, 26, e, a, b, c, d, VEC_SHA1_K2);
-	vecx_ROUND_O(vecx_F2, vecx_MX3, 27, d, e, a, b, c, VEC_SHA1_K2);
-	vecx_ROUND_O(vecx_F2, vecx_MX3, 28, c, d, e, a, b, VEC_SHA1_K2);
-	vecx_ROUND_O(vecx_F2, vecx_MX7, 29, b, c, d, e, a, VEC_SHA1_K2);
-	vecx_ROUND_O(vecx_F2, vecx_MX7, 30, a, b, c, d, e, VEC_SHA1_K2);
-	vecx_ROUND_O(vecx_F2, vecx_MXF, 31, e, a, b, c, d, VEC_SHA1_K2);
-	vecx_ROUND_O(vecx_F2, vecx_MXF, 32, d, e, a, b, c, VEC_SHA1_K2);
-	vecx_ROUND_O(vecx_F2, vecx_MXF, 33, c, d, e, a, b, VEC_SHA1_K2);
-	vecx_ROUND_O(vecx_F2, vecx_MXF, 34, b, c, d, e, a, VEC_SHA1_K2);
-	vecx_ROUND_O(vecx_F2, vecx_MXF, 35, a, b, c, d, e, VEC_SHA1_K2);
-	vecx_ROUND_O(vecx_F2, vecx_MXF, 36, e, a, b, c, d, VEC_SHA1_K2);
-	vecx_ROUND_O(vecx_F2, vecx_MXF, 37, d, e, a, b, c, VEC_SHA1_K2);
-	vecx_ROUND_O(vecx_F2, vecx_MXF, 38, c, d, e, a, b, VEC_SHA1_K2);
-	vecx_ROUND_O(vecx_F2, vecx_MXF, 39, b, c, d, e, a, VEC_SHA1_K2);
-
-	vecx_ROUND_O(vecx_F3, vecx_MXF, 40, a, b, c, d, e, VEC_SHA1_K3);
-	vecx_ROUND_O(vecx_F3, vecx_MXF, 41, e, a, b, c, d, VEC_SHA1_K3);
-	vecx_ROUND_O(vecx_F3, vecx_MXF, 42, d, e, a, b, c, VEC_SHA1_K3);
-	vecx_ROUND_O(vecx_F3, vecx_MXF, 43, c, d, e, a, b, VEC_SHA1_K3);
-	vecx_ROUND_O(vecx_F3, vecx_MXF, 44, b, c, d, e, a, VEC_SHA1_K3);
-	vecx_ROUND_O(vecx_F3, vecx_MXF, 45, a, b, c, d, e, VEC_SHA1_K3);
-	vecx_ROUND_O(vecx_F3, vecx_MXF, 46, e, a, b, c, d, VEC_SHA1_K3);
-	vecx_ROUND_O(vecx_F3, vecx_MXF, 47, d, e, a, b, c, VEC_SHA1_K3);
-	vecx_ROUND_O(vecx_F3, vecx_MXF, 48, c, d, e, a, b, VEC_SHA1_K3);
-	vecx_ROUND_O(vecx_F3, vecx_MXF, 49, b, c, d, e, a, VEC_SHA1_K3);
-	vecx_ROUND_O(vecx_F3, vecx_MXF, 50, a, b, c, d, e, VEC_SHA1_K3);
-	vecx_ROUND_O(vecx_F3, vecx_MXF, 51, e, a, b, c, d, VEC_SHA1_K3);
-	vecx_ROUND_O(vecx_F3, vecx_MXF, 52, d, e, a, b, c, VEC_SHA1_K3);
-	vecx_ROUND_O(vecx_F3, vecx_MXF, 53, c, d, e, a, b, VEC_SHA1_K3);
-	vecx_ROUND_O(vecx_F3, vecx_MXF, 54, b, c, d, e, a, VEC_SHA1_K3);
-	vecx_ROUND_O(vecx_F3, vecx_MXF, 55, a, b, c, d, e, VEC_SHA1_K3);
-	vecx_ROUND_O(vecx_F3, vecx_MXF, 56, e, a, b, c, d, VEC_SHA1_K3);
-	vecx_ROUND_O(vecx_F3, vecx_MXF, 57, d, e, a, b, c, VEC_SHA1_K3);
-	vecx_ROUND_O(vecx_F3, vecx_MXF, 58, c, d, e, a, b, VEC_SHA1_K3);
-	vecx_ROUND_O(vecx_F3, vecx_MXF, 59, b, c, d, e, a, VEC_SHA1_K3);
-
-	vecx_ROUND_O(vecx_F4, vecx_MXF, 60, a, b, c, d, e, VEC_SHA1_K4);
-	vecx_ROUND_O(vecx_F4, vecx_MXF, 61, e, a, b, c, d, VEC_SHA1_K4);
-	vecx_ROUND_O(vecx_F4, vecx_MXF, 62, d, e, a, b, c, VEC_SHA1_K4);
-	vecx_ROUND_O(vecx_F4, vecx_MXF, 63, c, d, e, a, b, VEC_SHA1_K4);
-	vecx_ROUND_O(vecx_F4, vecx_MXF, 64, b, c, d, e, a, VEC_SHA1_K4);
-	vecx_ROUND_O(vecx_F4, vecx_MXF, 65, a, b, c, d, e, VEC_SHA1_K4);
-	vecx_ROUND_O(vecx_F4, vecx_MXF, 66, e, a, b, c, d, VEC_SHA1_K4);
-	vecx_ROUND_O(vecx_F4, vecx_MXF, 67, d, e, a, b, c, VEC_SHA1_K4);
-	vecx_ROUND_O(vecx_F4, vecx_MXF, 68, c, d, e, a, b, VEC_SHA1_K4);
-	vecx_ROUND_O(vecx_F4, vecx_MXF, 69, b, c, d, e, a, VEC_SHA1_K4);
-	vecx_ROUND_O(vecx_F4, vecx_MXF, 70, a, b, c, d, e, VEC_SHA1_K4);
-	vecx_ROUND_O(vecx_F4, vecx_MXF, 71, e, a, b, c, d, VEC_SHA1_K4);
-	vecx_ROUND_O(vecx_F4, vecx_MXF, 72, d, e, a, b, c, VEC_SHA1_K4);
-	vecx_ROUND_O(vecx_F4, vecx_MXF, 73, c, d, e, a, b, VEC_SHA1_K4);
-	vecx_ROUND_O(vecx_F4, vecx_MXF, 74, b, c, d, e, a, VEC_SHA1_K4);
-	vecx_ROUND_O(vecx_F4, vecx_MXF, 75, a, b, c, d, e, VEC_SHA1_K4);
-	vecx_ROUND_O(vecx_F4, vecx_MXF, 76, e, a, b, c, d, VEC_SHA1_K4);
-	vecx_ROUND_F(vecx_F4, vecx_MXF, 77, d, e, a, b, c, VEC_SHA1_K4);
-	vecx_ROUND_F(vecx_F4, vecx_MXF, 78, c, d, e, a, b, VEC_SHA1_K4);
-	vecx_ROUND_F(vecx_F4, vecx_MXF, 79, b, c, d, e, a, VEC_SHA1_K4);
-
-	/* We keep the first 3 words (12B) as we only need 10B for this attack */
-	a = vecx_add(a, lv->H[0]);
-	b = vecx_add(b, lv->H[1]);
-	c = vecx_add(c, lv->H[2]);
-	/* 'd' contains garbage but we will not read it anyway */
-
-	vecx_transpose(a, b, c, d);
-
-	/* Store all output results */
-	vecx_store(bufout + 0 * VECX_WORD_SIZE, vecx_bswap(a));
-	vecx_store(bufout + 1 * VECX_WORD_SIZE, vecx_bswap(b));
-	vecx_store(bufout + 2 * VECX_WORD_SIZE, vecx_bswap(c));
-	vecx_store(bufout + 3 * VECX_WORD_SIZE, vecx_bswap(d));
+	vecx out[VEC_SHA1_LSCHED_SIZE];
+	vecx W[16];
+
+	for (int x = 0; x < 16; ++x)
+		W[x] = vecx_zero();
+	W[2] = vecx_add(vexpo_0, vecx_shr(vecx_even_numbers(), 1));
+
+	leek_exhaust_expand(out, 1, W);
+
+	for (int x = 0; x < VEC_SHA1_LSCHED_SIZE; ++x)
+		vecx_store(&lv->PS_L[x * VECX_VECTOR_LANES], out[x]);
 }
 
 
+/* Load pre-computed data for stream 't' and finish rounds 2 and 3 */
+#define vecx_FINAL_LOAD(t, vexpo_0)                                 \
+	do {                                                              \
+		a[(t)] = lv->PH[0];                                             \
+		b[(t)] = lv->PB_C03[(t)];                                       \
+		c[(t)] = lv->PH[2];                                             \
+		d[(t)] = lv->PH[3];                                             \
+		e[(t)] = lv->PH[4];                                             \
+                                                                    \
+		W[0][(t)]  = lv->PW_C00;                                        \
+		W[1][(t)]  = lv->PW_C01;                                        \
+		W[2][(t)]  = (vexpo_0);                                         \
+		W[3][(t)]  = lv->PW_C03[(t)];                                   \
+		W[15][(t)] = lv->PW_C15;                                        \
+                                                                    \
+		/* This finishes round 2 gracefully */                          \
+		c[(t)] = vecx_add(c[(t)], (vexpo_0));                           \
+                                                                    \
+		/* This finishes round 3 gracefully as well */                  \
+		b[(t)] = vecx_add(vecx_rol(c[(t)], 5), b[(t)]);                 \
+	} while (0)
+
+/* Expanded word 'x' of stream 't' from both pre-computed linear parts */
+#define vecx_LIN(x, t)                                              \
+	vecx_xor(lv->PW_L[(x) - VEC_SHA1_LBLOCK_SIZE][(t)],               \
+	         vecx_set(PS[((x) - VEC_SHA1_LBLOCK_SIZE) * VECX_VECTOR_LANES]))
+
+/* Bucket index is made of the 2 first bytes of the address (big endian 'a') */
+#if VECX_PROBE_GATHER
+/* Bitmap words are gathered as 32b words (little endian) */
+# define vecx_PROBE(t, mask)                                        \
+	do {                                                              \
+		(mask) |= (uint64_t) vecx_probe(vecx_bswap(a[(t)]),             \
+		                                leek.hashes.bitmap)             \
+		          << ((t) * VECX_VECTOR_LANES);                         \
+	} while (0)
+#else
+# define vecx_PROBE(t, mask)                                        \
+	do {                                                              \
+		uint32_t __a[VECX_VECTOR_LANES] __align(VECX_WORD_SIZE);        \
+                                                                    \
+		vecx_store(__a, a[(t)]);                                        \
+		for (int __l = 0; __l < VECX_VECTOR_LANES; ++__l) {             \
+			uint16_t __index = __builtin_bswap32(__a[__l]);               \
+			(mask) |= (uint64_t) leek_result_probe(&leek.hashes, __index)  \
+			          << ((t) * VECX_VECTOR_LANES + __l);                 \
+		}                                                               \
+	} while (0)
+#endif
+
+/* Compare the first address word with each target (small target sets) */
+#define vecx_MATCH(t, mask)                                         \
+	do {                                                              \
+		vecx __a = vecx_or(a[(t)], lv->MM);                             \
+		unsigned int __hits = 0;                                        \
+                                                                    \
+		for (unsigned int __k = 0; __k < lv->match_count; ++__k)        \
+			__hits |= vecx_cmpeq_mask(__a, lv->MT[__k]);                  \
+		(mask) |= (uint64_t) __hits << ((t) * VECX_VECTOR_LANES);       \
+	} while (0)
+
+/* Add the hash state of stream 't' (first 3 words only) and check each of
+ * its lanes for a possible result, hits are reported as bits of 'mask' */
+#define vecx_FINAL_PROBE(t, mask, match)                            \
+	do {                                                              \
+		a[(t)] = vecx_add(a[(t)], lv->H[0]);                            \
+		b[(t)] = vecx_add(b[(t)], lv->H[1]);                            \
+		c[(t)] = vecx_add(c[(t)], lv->H[2]);                            \
+		/* 'd' contains garbage but we will not read it anyway */       \
+                                                                    \
+		if (match)                                                      \
+			vecx_MATCH(t, mask);                                          \
+		else                                                            \
+			vecx_PROBE(t, mask);                                          \
+	} while (0)
+
+/* Store results of stream 't' (first 3 words only) as raw addresses */
+#define vecx_FINAL_STORE(t, bufout)                                 \
+	do {                                                              \
+		uint8_t *__out = (bufout) + 4 * (t) * VECX_WORD_SIZE;           \
+                                                                    \
+		vecx_transpose(a[(t)], b[(t)], c[(t)], d[(t)]);                 \
+                                                                    \
+		vecx_store(__out + 0 * VECX_WORD_SIZE, vecx_bswap(a[(t)]));     \
+		vecx_store(__out + 1 * VECX_WORD_SIZE, vecx_bswap(b[(t)]));     \
+		vecx_store(__out + 2 * VECX_WORD_SIZE, vecx_bswap(c[(t)]));     \
+		vecx_store(__out + 3 * VECX_WORD_SIZE, vecx_bswap(d[(t)]));     \
+	} while (0)
+
+
+/* Finalize variants (see leek_vecx_variant_names) */
+enum {
+	LEEK_VECX_FINAL_MX77,   /* on the fly expanded words, full W[77] array */
+	LEEK_VECX_FINAL_MX16,   /* on the fly expanded words, 16 words ring */
+	LEEK_VECX_FINAL_LIN,    /* expanded words from the linear pre-computes */
+};
+
+#define VECX_FINAL_NAME      leek_vecx_finalize_mx77
+#define VECX_FINAL_LINEAR    0
+#define VECX_FINAL_RING      0
+#include "vecx_final.h"
+
+#define VECX_FINAL_NAME      leek_vecx_finalize_mx16
+#define VECX_FINAL_LINEAR    0
+#define VECX_FINAL_RING      1
+#include "vecx_final.h"
+
+#define VECX_FINAL_NAME      leek_vecx_finalize_lin
+#define VECX_FINAL_LINEAR    1
+#define VECX_FINAL_RING      0
+#include "vecx_final.h"
+
+
 static void leek_vecx_block_finalize(struct leek_vecx *lv, const void *ptr,
                                      size_t total_len)
 {
@@ -355,37 +394,23 @@ static void leek_vecx_block_finalize(struct leek_vecx *lv, const void *ptr,
 
 
 /* Prepare exponent values used by exhaust loop */
-static void leek_exhaust_prepare(struct leek_vecx *lv)
+static __always_inline
+void leek_exhaust_prepare_tpl(struct leek_vecx *lv, const unsigned int expo_pos)
 {
-	vecx adder = vecx_even_numbers();
-	void *ptr[2];
-
 	/* Values added to every lane (instruction requires an immediate). */
-	switch (lv->expo_pos) {
-		case 0:
-			adder = vecx_shl(adder,  0);
-			break;
-
-		case 1:
-			adder = vecx_shl(adder,  8);
-			break;
-
-		case 2:
-			adder = vecx_shl(adder, 16);
-			break;
-
-		case 3:
-			adder = vecx_shl(adder, 24);
-			break;
-	};
+	vecx adder = vecx_shl(vecx_even_numbers(), 8 * expo_pos);
+	void *ptr[2];
 
 	/* Pointer to exponent words */
-	ptr[0] = &lv->block[VECX_WORD_SIZE * (lv->expo_round + 0)];
-	ptr[1] = &lv->block[VECX_WORD_SIZE * (lv->expo_round + 1)];
+	ptr[0] = &lv->block[VECX_WORD_SIZE * (VECX_EXPO_ROUND + 0)];
+	ptr[1] = &lv->block[VECX_WORD_SIZE * (VECX_EXPO_ROUND + 1)];
 
 	/* Store these values for use by the main exhaust loop */
 	lv->vexpo[0] = vecx_bswap(vecx_load(ptr[0]));
 	lv->vexpo[1] = vecx_add(vecx_bswap(vecx_load(ptr[1])), adder);
+
+	/* Each stream handles the next set of lanes (even exponents only) */
+	lv->vstream = vecx_set((2U << VECX_LANE_ORDER) << (8 * expo_pos));
 }
 
 
@@ -398,62 +423,175 @@ static void leek_vecx_block_update(struct leek_vecx *lv, const void *ptr)
 }
 
 
-/* Stage0: pre-compute first full SHA1 blocks */
-static int leek_vecx_precalc(struct leek_rsa_item *item, const void *ptr, size_t len)
+/* Full lookup of a candidate address (e is only needed on hits) */
+static __always_inline
+void leek_vecx_lookup(struct leek_rsa_item *item, struct leek_worker *wk,
+                      union leek_rawaddr *result, uint32_t e)
+{
+	unsigned int common;
+	unsigned int length;
+	int ret;
+
+	if (leek.options.flags & LEEK_OPTION_BEST) {
+		length = leek_result_lookup_best(wk->hashes, result, &common);
+		if (unlikely(common > wk->best_floor) && item->rsa)
+			leek_result_best_push(wk, result, e, common);
+	}
+	else
+		length = leek_result_lookup(wk->hashes, result);
+
+	/* Synthetic items (see tune.c) have no key to check */
+	if (likely(!length) || !item->rsa)
+		return;
+
+	ret = leek_result_recheck(item, e, result);
+	if (ret < 0)
+		__sync_add_and_fetch(&leek.stats.recheck_failures, 1);
+	else {
+		leek_result_handle(item->rsa, e, length, result);
+		item->flags |= LEEK_RSA_ITEM_DESTROY;
+	}
+}
+
+
+/* Queues a candidate address and prefetches what its lookup needs first */
+static __always_inline
+void leek_vecx_pending_push(struct leek_vecx *lv, struct leek_worker *wk,
+                            const union leek_rawaddr *result, uint32_t e,
+                            uint32_t step)
+{
+	uint32_t pos = lv->pending_head++ % VECX_PENDING_SIZE;
+
+	leek_result_prefetch(wk->hashes, result);
+	lv->pending[pos].addr = *result;
+	lv->pending[pos].e = e;
+	lv->pending[pos].step = step;
+}
+
+
+/* Resolves all pending candidates queued up to a given iteration */
+static __always_inline
+void leek_vecx_pending_resolve(struct leek_rsa_item *item, struct leek_worker *wk,
+                               uint32_t step)
 {
 	struct leek_vecx *lv = item->private_data;
-	size_t rem = len;
-	int ret = -1;
 
-	leek_vecx_reset(lv);
+	while (lv->pending_tail != lv->pending_head) {
+		uint32_t pos = lv->pending_tail % VECX_PENDING_SIZE;
 
-	while (rem >= VEC_SHA1_BLOCK_SIZE) {
-		leek_vecx_block_update(lv, ptr);
-		leek_vecx_update(lv);
-		rem -= VEC_SHA1_BLOCK_SIZE;
-		ptr = (uint8_t *) ptr + VEC_SHA1_BLOCK_SIZE;
+		if ((int32_t) (lv->pending[pos].step - step) > 0)
+			break;
+		leek_vecx_lookup(item, wk, &lv->pending[pos].addr, lv->pending[pos].e);
+		lv->pending_tail++;
 	}
+}
 
-	/* These checks are *HIGHLY* improbable in theory, but let's be safe here */
-	if (rem < LEEK_RSA_E_SIZE) {
-		/* This makes it impossible to iterate over exponent in the last block */
-		fprintf(stderr, "SHA1 init failed: too few data in last hash block.\n");
-		goto out;
+#if VECX_SCAN_GATHER
+/* Prefilter of all lanes on grams (substring and suffix modes), only lanes
+ * which may hold a word go through the automaton (see leek_result_lookup).
+ * Address words are gathered back from results, then each gram is probed
+ * with a gather as well. */
+static __always_inline
+uint64_t leek_vecx_scan(const struct leek_vecx *lv, const struct leek_automaton *automaton)
+{
+	const unsigned int last = automaton->gram_first + automaton->gram_count;
+	vecx offsets = vecx_shl(vecx_even_numbers(), 1);
+	vecx gram_mask = vecx_set((1U << LEEK_AUTOMATON_GRAM_BITS) - 1);
+	uint64_t mask = 0;
+
+	for (unsigned int t = 0; t < VECX_STREAM_COUNT; ++t) {
+		const void *base = &lv->R[t * VECX_VECTOR_LANES];
+		vecx words[3];
+		uint64_t found = 0;
+
+		for (unsigned int k = 0; k < 3; ++k)
+			words[k] = vecx_bswap(vecx_gather(base, vecx_add(offsets, vecx_set(k))));
+
+		for (unsigned int p = automaton->gram_first; p < last; ++p) {
+			unsigned int k = (LEEK_RAWADDR_CHAR_BITS * p) / 32;
+			unsigned int bit = (LEEK_RAWADDR_CHAR_BITS * p) % 32;
+			vecx gram;
+
+			/* Grams may lie accross two words */
+			if (bit <= 32 - LEEK_AUTOMATON_GRAM_BITS)
+				gram = vecx_shr(words[k], 32 - LEEK_AUTOMATON_GRAM_BITS - bit);
+			else
+				gram = vecx_or(vecx_shl(words[k], bit - (32 - LEEK_AUTOMATON_GRAM_BITS)),
+				               vecx_shr(words[k + 1], 64 - LEEK_AUTOMATON_GRAM_BITS - bit));
+
+			found |= vecx_test(vecx_and(gram, gram_mask), automaton->grams);
+		}
+
+		mask |= found << (t * VECX_VECTOR_LANES);
 	}
 
-	if (rem > (VEC_SHA1_BLOCK_SIZE - sizeof(uint64_t) - 1)) {
-		/* This makes it impossible to finalize hash in the same block as exponent */
-		fprintf(stderr, "SHA1 init failed: too much data in last hash block.\n");
-		goto out;
+	return mask;
+}
+#else
+/* Prefilter of all lanes on grams (substring and suffix modes), only lanes
+ * which may hold a word go through the automaton (see leek_result_lookup). */
+static __always_inline
+uint64_t leek_vecx_scan(const struct leek_vecx *lv, const struct leek_automaton *automaton)
+{
+	const unsigned int last = automaton->gram_first + automaton->gram_count;
+	const uint32_t gram_mask = (1U << LEEK_AUTOMATON_GRAM_BITS) - 1;
+	uint64_t high[VECX_LANE_COUNT];
+	uint64_t low[VECX_LANE_COUNT];
+	uint64_t mask = 0;
+
+	/* First 64 bits and last 64 bits of addresses */
+	for (unsigned int u = 0; u < VECX_LANE_COUNT; ++u) {
+		high[u] = be64toh(*(const uint64_t *) lv->R[u].addr.buffer);
+		low[u] = be16toh(*(const uint16_t *) &lv->R[u].addr.buffer[8]) | (high[u] << 16);
 	}
 
-	leek_vecx_block_finalize(lv, ptr, len);
-	leek_exhaust_prepare(lv);
-	leek_exhaust_precalc_1(lv);
+	for (unsigned int p = automaton->gram_first; p < last; ++p) {
+		unsigned int shift = 8 * LEEK_RAWADDR_LEN - LEEK_AUTOMATON_GRAM_BITS
+		                   - LEEK_RAWADDR_CHAR_BITS * p;
 
-	ret = 0;
-out:
-	return ret;
+		for (unsigned int u = 0; u < VECX_LANE_COUNT; ++u) {
+			uint32_t gram = (shift >= 64 - LEEK_AUTOMATON_GRAM_BITS) ? high[u] >> (shift - 16)
+			                                                         : low[u] >> shift;
+
+			mask |= (uint64_t) leek_automaton_gram(automaton, gram & gram_mask) << u;
+		}
+	}
+
+	return mask;
 }
+#endif
 
-static int leek_vecx_exhaust(struct leek_rsa_item *item, struct leek_worker *wk)
+_Static_assert(VECX_PENDING_SIZE >= (LEEK_LOOKUP_DEPTH_MAX + 1) * VECX_LANE_COUNT,
+               "Pending ring cannot hold all deferred lookups.");
+
+
+/* Exhaust loop, specialized on the exponent position (all bounds are constants),
+ * the finalize variant and the way candidates are filtered (bitmap or match). */
+static __always_inline
+int leek_vecx_exhaust_tpl(struct leek_rsa_item *item, struct leek_worker *wk,
+                          const unsigned int expo_pos, const int final,
+                          const int match)
 {
 	struct leek_vecx *lv = item->private_data;
-	uint32_t increment = 1 << ((8 * lv->expo_pos) + VECX_INCR_ORDER);
-	unsigned int iter_count = (LEEK_RSA_E_LIMIT - LEEK_RSA_E_START + 2) >> 4;
+	const uint32_t increment = 1 << ((8 * expo_pos) + VECX_INCR_ORDER);
+	const unsigned int iter_count = (LEEK_RSA_E_LIMIT - LEEK_RSA_E_START + 2) >> 4;
 	unsigned int outer_count;
 	unsigned int outer_init;
 	unsigned int inner_count;
 	unsigned int inner_init;
+	/* Hits are prefetched and resolved 'depth' iterations later */
+	const unsigned int depth = leek.options.lookup_depth;
+	const struct leek_automaton *automaton = NULL;
+	uint32_t step = 0;
 	vecx vexpo[2];  /* current exponents words (high / low) */
 	vecx vincr[2];  /* increments (high / low)*/
 
 	/* Handle different alignments (else clause will never happen anyway...) */
-	if (lv->expo_pos) {
-		outer_count = (LEEK_RSA_E_LIMIT + 2U) >> (8 * (4 - lv->expo_pos));
-		outer_init = (LEEK_RSA_E_START) >> (8 * (4 - lv->expo_pos));
-		inner_count = (1ULL << (8 * (4 - lv->expo_pos) - VECX_INCR_ORDER));
-		inner_init = iter_count & (byte_mask(4 - lv->expo_pos) >> VECX_INCR_ORDER);
+	if (expo_pos) {
+		outer_count = (LEEK_RSA_E_LIMIT + 2U) >> (8 * (4 - expo_pos));
+		outer_init = (LEEK_RSA_E_START) >> (8 * (4 - expo_pos));
+		inner_count = (1ULL << (8 * (4 - expo_pos) - VECX_INCR_ORDER));
+		inner_init = iter_count & (byte_mask(4 - expo_pos) >> VECX_INCR_ORDER);
 	}
 	else {
 		outer_count = 1;
@@ -468,6 +606,12 @@ static int leek_vecx_exhaust(struct leek_rsa_item *item, struct leek_worker *wk)
 	vexpo[0] = lv->vexpo[0];
 	vexpo[1] = lv->vexpo[1];
 
+	lv->pending_head = 0;
+	lv->pending_tail = 0;
+
+	if (wk->hashes->automaton.delta)
+		automaton = &wk->hashes->automaton;
+
 	/* While using RSA 1024, inner is 16 and outer is 8388608 (on AVX2)
 	 * This makes sense to perform the outer loop inside the inner loop
 	 * to perform less stage 2 pre-comptutes */
@@ -475,36 +619,54 @@ static int leek_vecx_exhaust(struct leek_rsa_item *item, struct leek_worker *wk)
 	 * 8 * ((outer_count - outer_init) * inner_count - inner_init) */
 
 	for (unsigned int i = inner_init; i < inner_count; ++i) {
-		leek_exhaust_precalc_2(lv, vexpo[1]);
+		leek_exhaust_precalc_2(lv, vexpo[1], final == LEEK_VECX_FINAL_LIN);
 		vexpo[0] = lv->vexpo[0];
 
 		for (unsigned int o = outer_init; o < outer_count; ++o) {
-			leek_vecx_finalize(lv, vexpo[0]);
-
-			/* Check results for all lanes here */
-			for (int r = 0; r < VECX_LANE_COUNT; ++r) {
-				union leek_rawaddr *result;
-				unsigned int length;
-				int ret;
-
-				result = &lv->R[r].addr;
-
-				length = leek_result_lookup(result);
-				if (unlikely(length)) {
-					/* What's my e again? */
-					uint32_t e = 2 * (VECX_LANE_COUNT * (o * inner_count + i) + r) + 1;
-					ret = leek_result_recheck(item, e, result);
-					if (ret < 0)
-						__sync_add_and_fetch(&leek.stats.recheck_failures, 1);
-					else {
-						leek_result_handle(item->rsa, e, length, result);
-						item->flags |= LEEK_RSA_ITEM_DESTROY;
-					}
-				}
+			unsigned int lane = (o - outer_init) % VECX_VECTOR_LANES;
+			uint64_t mask;
+
+			switch (final) {
+				case LEEK_VECX_FINAL_MX77:
+					mask = leek_vecx_finalize_mx77(lv, vexpo[0], lane, match);
+					break;
+				case LEEK_VECX_FINAL_MX16:
+					mask = leek_vecx_finalize_mx16(lv, vexpo[0], lane, match);
+					break;
+				default:
+					if (!lane)
+						leek_exhaust_precalc_3(lv, vexpo[0]);
+					mask = leek_vecx_finalize_lin(lv, vexpo[0], lane, match);
+					break;
 			}
 
+			/* Bitmap is full with an automaton, all lanes are scanned here */
+			if (automaton)
+				mask = leek_vecx_scan(lv, automaton);
+
+			/* Only lanes hitting a non-empty bucket need a full lookup */
+			while (unlikely(mask)) {
+				unsigned int u = __builtin_ctzll(mask);
+				/* What's my e again? */
+				uint32_t e = 2 * (VECX_LANE_COUNT * (o * inner_count + i) + u) + 1;
+
+				mask &= mask - 1;
+				if (depth)
+					leek_vecx_pending_push(lv, wk, &lv->R[u].addr, e, step);
+				else
+					leek_vecx_lookup(item, wk, &lv->R[u].addr, e);
+			}
+
+			if (lv->pending_tail != lv->pending_head)
+				leek_vecx_pending_resolve(item, wk, step - depth);
+			step++;
+
 			vexpo[0] = vecx_add(vexpo[0], vincr[0]);
 			wk->stats.hash_count += VECX_LANE_COUNT;
+
+			/* An inner loop takes seconds, check for exit requests here as well */
+			if (unlikely(!(o & 0xffff)) && (wk->flags & LEEK_WORKER_FLAG_EXITING))
+				goto exiting;
 		}
 
 		/* Check for LEEK_WORKER_FLAG_EXITING */
@@ -514,19 +676,191 @@ static int leek_vecx_exhaust(struct leek_rsa_item *item, struct leek_worker *wk)
 		vexpo[1] = vecx_add(vexpo[1], vincr[1]);
 	}
 
+	leek_vecx_pending_resolve(item, wk, step);
 	return 1;
 
 exiting:
+	leek_vecx_pending_resolve(item, wk, step);
 	return 0;
 }
 
+/* Generates a prepare function for each exponent position */
+#define LEEK_VECX_PREPARE_DEFINE(_pos)                                       \
+	static void leek_exhaust_prepare_##_pos(struct leek_vecx *lv)              \
+	{                                                                          \
+		leek_exhaust_prepare_tpl(lv, _pos);                                      \
+	}
+
+/* Generates a specialized exhaust kernel */
+#define LEEK_VECX_KERNEL_DEFINE(_name, _pos, _final, _match, _attr)          \
+	static _attr int leek_vecx_exhaust_##_name(struct leek_rsa_item *item,     \
+	                                           struct leek_worker *wk)         \
+	{                                                                          \
+		return leek_vecx_exhaust_tpl(item, wk, _pos, _final, _match);            \
+	}
+
+LEEK_VECX_PREPARE_DEFINE(0)
+LEEK_VECX_PREPARE_DEFINE(1)
+LEEK_VECX_PREPARE_DEFINE(2)
+LEEK_VECX_PREPARE_DEFINE(3)
+
+/* Kernel variants for position 3 (see leek_vecx_variant_names) */
+enum {
+	LEEK_VECX_VARIANT_MX77,
+	LEEK_VECX_VARIANT_MX16,
+	LEEK_VECX_VARIANT_LIN,
+};
+
+/* Default variant (when autotune is not performed) */
+#if VECX_LINEAR_SCHEDULE
+# define LEEK_VECX_FINAL_DEFAULT     LEEK_VECX_FINAL_LIN
+# define LEEK_VECX_VARIANT_DEFAULT   LEEK_VECX_VARIANT_LIN
+#else
+# define LEEK_VECX_FINAL_DEFAULT     LEEK_VECX_FINAL_MX77
+# define LEEK_VECX_VARIANT_DEFAULT   LEEK_VECX_VARIANT_MX77
+#endif
+
+/* DER layout of 1024b keys always puts the exponent MSB at position 3,
+ * only this position gets all the finalize variants and the matcher. */
+LEEK_VECX_KERNEL_DEFINE(0, 0, LEEK_VECX_FINAL_DEFAULT, 0, __cold)
+LEEK_VECX_KERNEL_DEFINE(1, 1, LEEK_VECX_FINAL_DEFAULT, 0, __cold)
+LEEK_VECX_KERNEL_DEFINE(2, 2, LEEK_VECX_FINAL_DEFAULT, 0, __cold)
+LEEK_VECX_KERNEL_DEFINE(3_mx77,   3, LEEK_VECX_FINAL_MX77, 0, __hot)
+LEEK_VECX_KERNEL_DEFINE(3_mx16,   3, LEEK_VECX_FINAL_MX16, 0, __hot)
+LEEK_VECX_KERNEL_DEFINE(3_lin,    3, LEEK_VECX_FINAL_LIN,  0, __hot)
+LEEK_VECX_KERNEL_DEFINE(3_mx77_m, 3, LEEK_VECX_FINAL_MX77, 1, __hot)
+LEEK_VECX_KERNEL_DEFINE(3_mx16_m, 3, LEEK_VECX_FINAL_MX16, 1, __hot)
+LEEK_VECX_KERNEL_DEFINE(3_lin_m,  3, LEEK_VECX_FINAL_LIN,  1, __hot)
+
+/* Variants names and kernels (exponent at position 3), see tune.c */
+static const char *const leek_vecx_variant_names[] = {
+	[LEEK_VECX_VARIANT_MX77] = "mx77",
+	[LEEK_VECX_VARIANT_MX16] = "mx16",
+	[LEEK_VECX_VARIANT_LIN]  = "lin",
+	NULL,
+};
+
+static const leek_vecx_exhaust_t leek_vecx_variant_kernels[] = {
+	[LEEK_VECX_VARIANT_MX77] = leek_vecx_exhaust_3_mx77,
+	[LEEK_VECX_VARIANT_MX16] = leek_vecx_exhaust_3_mx16,
+	[LEEK_VECX_VARIANT_LIN]  = leek_vecx_exhaust_3_lin,
+};
+
+/* Same kernels for small target sets (see leek_hashes_match_build) */
+static const leek_vecx_exhaust_t leek_vecx_variant_match_kernels[] = {
+	[LEEK_VECX_VARIANT_MX77] = leek_vecx_exhaust_3_mx77_m,
+	[LEEK_VECX_VARIANT_MX16] = leek_vecx_exhaust_3_mx16_m,
+	[LEEK_VECX_VARIANT_LIN]  = leek_vecx_exhaust_3_lin_m,
+};
+
+/* Currently selected variant (set before any worker starts) */
+static unsigned int leek_vecx_variant = LEEK_VECX_VARIANT_DEFAULT;
+
+static void leek_vecx_variant_set(unsigned int variant)
+{
+	leek_vecx_variant = variant;
+}
+
+static const struct leek_vecx_kernel {
+	void (*prepare)(struct leek_vecx *);
+	leek_vecx_exhaust_t exhaust;
+} leek_vecx_kernels[4] = {
+	{ leek_exhaust_prepare_0, leek_vecx_exhaust_0 },
+	{ leek_exhaust_prepare_1, leek_vecx_exhaust_1 },
+	{ leek_exhaust_prepare_2, leek_vecx_exhaust_2 },
+	{ leek_exhaust_prepare_3, NULL },  /* see leek_vecx_variant_kernels */
+};
+
+
+static int leek_vecx_exhaust(struct leek_rsa_item *item, struct leek_worker *wk)
+{
+	struct leek_vecx *lv = item->private_data;
+
+	/* Specialized kernel was selected by leek_vecx_precalc */
+	return lv->exhaust(item, wk);
+}
+
+
+/* Broadcast small target sets (only used when under VECX_MATCH_MAX) */
+static void leek_vecx_match_load(struct leek_vecx *lv)
+{
+	lv->match_count = 0;
+	if (leek.hashes.match_count > VECX_MATCH_MAX)
+		return;
+
+	lv->MM = vecx_set(leek.hashes.match_mask);
+	for (unsigned int k = 0; k < leek.hashes.match_count; ++k)
+		lv->MT[k] = vecx_set(leek.hashes.match[k]);
+	lv->match_count = leek.hashes.match_count;
+}
+
+
+/* Stage0: pre-compute first full SHA1 blocks */
+static int leek_vecx_precalc(struct leek_rsa_item *item, const void *ptr, size_t len)
+{
+	struct leek_vecx *lv = item->private_data;
+	const struct leek_vecx_kernel *kernel;
+	size_t rem = len;
+	int ret = -1;
+
+	leek_vecx_reset(lv);
+
+	while (rem >= VEC_SHA1_BLOCK_SIZE) {
+		leek_vecx_block_update(lv, ptr);
+		leek_vecx_update(lv);
+		rem -= VEC_SHA1_BLOCK_SIZE;
+		ptr = (uint8_t *) ptr + VEC_SHA1_BLOCK_SIZE;
+	}
+
+	/* These checks are *HIGHLY* improbable in theory, but let's be safe here */
+	if (rem < LEEK_RSA_E_SIZE) {
+		/* This makes it impossible to iterate over exponent in the last block */
+		fprintf(stderr, "SHA1 init failed: too few data in last hash block.\n");
+		goto out;
+	}
+
+	if (rem > (VEC_SHA1_BLOCK_SIZE - sizeof(uint64_t) - 1)) {
+		/* This makes it impossible to finalize hash in the same block as exponent */
+		fprintf(stderr, "SHA1 init failed: too much data in last hash block.\n");
+		goto out;
+	}
+
+	leek_vecx_block_finalize(lv, ptr, len);
+
+	/* Finalize rounds are written for the exponent in words 2 and 3 */
+	if (lv->expo_round != VECX_EXPO_ROUND) {
+		fprintf(stderr, "SHA1 init failed: unsupported exponent location.\n");
+		goto out;
+	}
+
+	leek_vecx_match_load(lv);
+
+	kernel = &leek_vecx_kernels[lv->expo_pos];
+	kernel->prepare(lv);
+	lv->exhaust = kernel->exhaust;
+	if (!lv->exhaust) {
+		lv->exhaust = leek_vecx_variant_kernels[leek_vecx_variant];
+		if (lv->match_count)
+			lv->exhaust = leek_vecx_variant_match_kernels[leek_vecx_variant];
+	}
+
+	leek_exhaust_precalc_1(lv);
+
+	ret = 0;
+out:
+	return ret;
+}
+
 #define LEEK_VECX_DEFINE(_name)                         \
 	const struct leek_implementation _name = {            \
-		.name      = VECX_IMPL_NAME,                        \
-		.weight    = VECX_LANE_COUNT,                       \
-		.available = leek_vecx_available,                   \
-		.allocate  = leek_vecx_alloc,                       \
-		.precalc   = leek_vecx_precalc,                     \
-		.exhaust   = leek_vecx_exhaust,                     \
+		.name        = VECX_IMPL_NAME,                      \
+		.weight      = VECX_IMPL_WEIGHT,                    \
+		.available   = leek_vecx_available,                 \
+		.allocate    = leek_vecx_alloc,                     \
+		.cleanup     = leek_vecx_cleanup,                   \
+		.precalc     = leek_vecx_precalc,                   \
+		.exhaust     = leek_vecx_exhaust,                   \
+		.variants    = leek_vecx_variant_names,             \
+		.variant_set = leek_vecx_variant_set,               \
 	}
 #endif /* !__LEEK_VECX_H */
@@ -5,6 +5,7 @@
 /* VEC shared macros and constants */
 # define VEC_SHA1_LBLOCK_SIZE    16
 # define VEC_SHA1_BLOCK_SIZE     (VEC_SHA1_LBLOCK_SIZE * 4)
+# define VEC_SHA1_LSCHED_SIZE    (80 - VEC_SHA1_LBLOCK_SIZE) /* expanded words */
 # define VEC_RAWADDR_LEN         16
 # define VEC_CACHELINE_SIZE      64 /* hardwired to 512 bits */
 # define __align(x)              __attribute__((aligned((x))))
@@ -22,10 +23,65 @@
 # define VEC_SHA1_K3    0x8f1bbcdc
 # define VEC_SHA1_K4    0xca62c1d6
 
+/* Number of independent vectors interleaved by the exhaust loop */
+# ifndef VECX_STREAM_ORDER
+#  define VECX_STREAM_ORDER  0
+# endif
+
 /* Let's enhance these sets of macros with relevant defines for SHA1 */
-# define VECX_LANE_COUNT    (1 << VECX_LANE_ORDER)
-# define VECX_WORD_SIZE      (4 * VECX_LANE_COUNT)
-# define VECX_INCR_ORDER     (VECX_LANE_ORDER + 1)
+# define VECX_VECTOR_LANES   (1 << VECX_LANE_ORDER)
+# define VECX_STREAM_COUNT   (1 << VECX_STREAM_ORDER)
+# define VECX_LANE_COUNT     (VECX_VECTOR_LANES * VECX_STREAM_COUNT)
+# define VECX_WORD_SIZE      (4 * VECX_VECTOR_LANES)
+# define VECX_INCR_ORDER     (VECX_LANE_ORDER + VECX_STREAM_ORDER + 1)
+
+/* Finalize reports bucket hits as a 64b lanes mask (see vecx.h) */
+# if VECX_LANE_COUNT > 64
+#  error "Too many lanes for the finalize hit mask."
+# endif
+
+/* Lanes waiting for their full lookup, one kernel iteration may push
+ * VECX_LANE_COUNT of them (see LEEK_LOOKUP_DEPTH_MAX in options.h) */
+# define VECX_PENDING_SIZE   (8 * VECX_LANE_COUNT)
+
+/* Default finalize variant pre-computes the linear parts of the message
+ * schedule (see vecx.h), autotune may choose another one at startup. */
+# ifndef VECX_LINEAR_SCHEDULE
+#  define VECX_LINEAR_SCHEDULE  1
+# endif
+
+/* Bucket bitmap is probed one lane at a time unless vecx_probe is provided */
+# ifndef VECX_PROBE_GATHER
+#  define VECX_PROBE_GATHER  0
+# endif
+
+/* Automaton grams are probed one lane at a time unless vecx_test is provided */
+# ifndef VECX_SCAN_GATHER
+#  define VECX_SCAN_GATHER  0
+# endif
+
+/* Largest target set compared in registers instead of the bitmap probe
+ * (up to LEEK_HASH_MATCH_MAX, gains fade out after a few targets) */
+# ifndef VECX_MATCH_MAX
+#  define VECX_MATCH_MAX  8
+# endif
+
+/* Implementation weight defaults to the vector width (see impl.c) */
+# ifndef VECX_IMPL_WEIGHT
+#  define VECX_IMPL_WEIGHT   VECX_VECTOR_LANES
+# endif
+
+/* Expand a stream macro for each stream (loops are avoided on purpose) */
+# if VECX_STREAM_ORDER == 0
+#  define vecx_EACH(r, ...)  r(0, __VA_ARGS__)
+# elif VECX_STREAM_ORDER == 1
+#  define vecx_EACH(r, ...)  r(0, __VA_ARGS__); r(1, __VA_ARGS__)
+# elif VECX_STREAM_ORDER == 2
+#  define vecx_EACH(r, ...)  r(0, __VA_ARGS__); r(1, __VA_ARGS__); \
+                             r(2, __VA_ARGS__); r(3, __VA_ARGS__)
+# else
+#  error "Invalid value for VECX_STREAM_ORDER."
+# endif
 
 # define vecx_add3(a, ...) vecx_add(a, vecx_add(__VA_ARGS__))
 # define vecx_add4(a, ...) vecx_add(a, vecx_add3(__VA_ARGS__))
@@ -56,42 +112,52 @@
 
 
 /** Optimized rounds **/
-# define vecx_LDW(x) W[(x)]              /* Load pre-computed word */
+/* These operate on stream 't', where W and a, b, c, d, e are arrays of streams.
+ * Words are accessed through vecx_WX so that W can also be a 16 words ring. */
+# define vecx_WX(x, t)    W[(x)][(t)]
+# define vecx_LDW(x, t)   vecx_WX(x, t)    /* Load pre-computed word */
+# define vecx_SRS(x, t)   vecx_SRC(x)      /* Input data (shared by all streams) */
 
 /* Some specific MIX operations (when W data is known to be zero) */
-# define vecx_MX1(x) vecx_rol(         (W[(x)-3]                                ), 1)
-# define vecx_MX3(x) vecx_rol(vecx_xor2(W[(x)-3], W[(x)-8]                      ), 1)
-# define vecx_MX7(x) vecx_rol(vecx_xor3(W[(x)-3], W[(x)-8], W[(x)-14]           ), 1)
-# define vecx_MX9(x) vecx_rol(vecx_xor2(W[(x)-3],                      W[(x)-16]), 1)
-# define vecx_MXC(x) vecx_rol(vecx_xor2(                    W[(x)-14], W[(x)-16]), 1)
-# define vecx_MXF(x) vecx_rol(vecx_xor4(W[(x)-3], W[(x)-8], W[(x)-14], W[(x)-16]), 1)
+# define vecx_MX1(x, t) vecx_rol(         (vecx_WX((x)-3, t)                                                ), 1)
+# define vecx_MX3(x, t) vecx_rol(vecx_xor2(vecx_WX((x)-3, t), vecx_WX((x)-8, t)                             ), 1)
+# define vecx_MX7(x, t) vecx_rol(vecx_xor3(vecx_WX((x)-3, t), vecx_WX((x)-8, t), vecx_WX((x)-14, t)         ), 1)
+# define vecx_MX9(x, t) vecx_rol(vecx_xor2(vecx_WX((x)-3, t),                                        vecx_WX((x)-16, t)), 1)
+# define vecx_MXC(x, t) vecx_rol(vecx_xor2(                                      vecx_WX((x)-14, t), vecx_WX((x)-16, t)), 1)
+# define vecx_MXF(x, t) vecx_rol(vecx_xor4(vecx_WX((x)-3, t), vecx_WX((x)-8, t), vecx_WX((x)-14, t), vecx_WX((x)-16, t)), 1)
 
 /* Optimized general round, our W buffer is not limited to 16 items */
-# define vecx_ROUND_O(f, s, x, a, b, c, d, e, k)                    \
+# define vecx_ROUND_O(t, f, s, x, a, b, c, d, e, k)                 \
 	do{                                                               \
-		vecx tmp = s(x);                                                \
-		W[(x)] = tmp;                                                   \
-		e = vecx_add5(e, tmp, vecx_rol(a, 5), f(b, c, d), vecx_set(k)); \
-		b = vecx_ror(b, 2);                                             \
+		vecx tmp = s(x, t);                                             \
+		vecx_WX(x, t) = tmp;                                            \
+		e[(t)] = vecx_add5(e[(t)], tmp, vecx_rol(a[(t)], 5),            \
+		                   f(b[(t)], c[(t)], d[(t)]), vecx_set(k));     \
+		b[(t)] = vecx_ror(b[(t)], 2);                                   \
 	} while (0)
 
 /* Final rounds, no store */
-# define vecx_ROUND_F(f, s, x, a, b, c, d, e, k)                    \
+# define vecx_ROUND_F(t, f, s, x, a, b, c, d, e, k)                 \
 	do{                                                               \
-		vecx tmp = s(x);                                                \
-		e = vecx_add5(e, tmp, vecx_rol(a, 5), f(b, c, d), vecx_set(k)); \
-		b = vecx_ror(b, 2);                                             \
+		vecx tmp = s(x, t);                                             \
+		e[(t)] = vecx_add5(e[(t)], tmp, vecx_rol(a[(t)], 5),            \
+		                   f(b[(t)], c[(t)], d[(t)]), vecx_set(k));     \
+		b[(t)] = vecx_ror(b[(t)], 2);                                   \
 	} while (0)
 
 /* Empty data, no load, no store */
-# define vecx_ROUND_E(f, x, a, b, c, d, e, k)                       \
+# define vecx_ROUND_E(t, f, x, a, b, c, d, e, k)                    \
 	do{                                                               \
-		e = vecx_add4(e, vecx_rol(a, 5), f(b, c, d), vecx_set(k));      \
-		b = vecx_ror(b, 2);                                             \
+		e[(t)] = vecx_add4(e[(t)], vecx_rol(a[(t)], 5),                 \
+		                   f(b[(t)], c[(t)], d[(t)]), vecx_set(k));     \
+		b[(t)] = vecx_ror(b[(t)], 2);                                   \
 	} while (0)
 
 # define byte_mask(x)  ((1 << (8 * (x))) - 1)
 
+/* Word holding the exponent MSBs in the last block (1024b RSA keys) */
+# define VECX_EXPO_ROUND  2
+
 
 /* 'addr' is 10 bytes but we need to round to the next power of 2
  * This union just ensures that we are aligned on a 16B boundary */
@@ -101,9 +167,15 @@ union vec_rawaddr {
 };
 
 
+struct leek_rsa_item;
+struct leek_worker;
+
+/* Exhaust loop specialized for the current exponent location */
+typedef int (*leek_vecx_exhaust_t)(struct leek_rsa_item *, struct leek_worker *);
+
 struct leek_vecx {
-	/* Internal state for "LANE_COUNT" SHA1 blocks (update only) */
-	uint8_t block[VECX_LANE_COUNT * VEC_SHA1_BLOCK_SIZE];
+	/* Internal state for "VECTOR_LANES" SHA1 blocks (update only) */
+	uint8_t block[VECX_VECTOR_LANES * VEC_SHA1_BLOCK_SIZE];
 
 	/* Where the exponent is located (MSB) */
 	/* This also sets the number of static rounds */
@@ -111,24 +183,54 @@ struct leek_vecx {
 	/* Where the exponent starts located in the last 32b word (0 to 3)*/
 	unsigned int expo_pos;
 
+	/* Specialized exhaust loop (selected by exponent position) */
+	leek_vecx_exhaust_t exhaust;
+
 	/* Hash state before last block */
 	vecx H[5];
 
 	/* Base exponent snapshot (little-endian, High, Low) */
 	vecx vexpo[2];
 
+	/* Low exponent word increment between two consecutive streams */
+	vecx vstream;
+
 	/* Pre-computed values (post stage 1) */
 	vecx __cache_align PH[5]; /* Values a, b, c, d, e */
 
 	vecx PW_C00; /* Static word 0 */
 	vecx PW_C01; /* Static word 1 */
-	vecx PW_C03; /* Static (stage 2) word 3 (exponent LSBs) */
 	vecx PW_C15; /* W word for cycle 15 (hash size) */
 
 	vecx PA_C03; /* 'add' pre-compute for cycle 3 (post stage 1) */
 
+	/* Pre-computed values (post stage 2), one for each stream */
+	vecx PW_C03[VECX_STREAM_COUNT]; /* Static word 3 (exponent LSBs) */
+	vecx PB_C03[VECX_STREAM_COUNT]; /* Temporary 'b' value for cycle 3 */
+
+	/* Expanded words 16 to 79 with word 2 set to zero (post stage 2) */
+	vecx PW_L[VEC_SHA1_LSCHED_SIZE][VECX_STREAM_COUNT];
+
+	/* Expanded words 16 to 79 from word 2 only (post stage 3)
+	 * for "VECTOR_LANES" consecutive values, stored as [word][value] */
+	uint32_t __cache_align PS_L[VEC_SHA1_LSCHED_SIZE * VECX_VECTOR_LANES];
+
+	/* First address words of small target sets (broadcast), see hashes.c */
+	vecx MM;
+	vecx MT[LEEK_HASH_MATCH_MAX];
+	unsigned int match_count;
+
 	/* Final resulting addresses (hashes) */
 	union vec_rawaddr R[VECX_LANE_COUNT];
+
+	/* Prefetched addresses resolved a few iterations later (ring buffer) */
+	struct {
+		union leek_rawaddr addr;
+		uint32_t e;
+		uint32_t step;
+	} pending[VECX_PENDING_SIZE];
+	uint32_t pending_head;
+	uint32_t pending_tail;
 };
 
 #endif /* !__LEEK_VECX_CORE_H */
@@ -0,0 +1,147 @@
+/* TO BE INCLUDED FROM vecx.h, ONCE PER FINALIZE VARIANT */
+/* Parameters (all of them are undefined at the end of this file):
+ *  - VECX_FINAL_NAME: name of the generated finalize function,
+ *  - VECX_FINAL_LINEAR: expanded words come from the linear pre-computes,
+ *  - VECX_FINAL_RING: expanded words live in a rolling 16 words schedule. */
+
+#if VECX_FINAL_LINEAR
+# define vecx_SCHED(mx)  vecx_LIN
+#else
+/* Expanded words are computed on the fly (skipping known zero words) */
+# define vecx_SCHED(mx)  mx
+#endif
+
+#if VECX_FINAL_RING
+# undef vecx_WX
+# define vecx_WX(x, t)   W[(x) & 15][(t)]
+#endif
+
+/* Customized hash function (final block)
+ * 'lane' selects the value of W[2] among the ones pre-computed in stage 3
+ * 'match' compares with small target sets instead of probing the bitmap
+ * Returns the mask of lanes that may hold a result (see lv->R) */
+static __always_inline
+uint64_t VECX_FINAL_NAME(struct leek_vecx *lv, vecx vexpo_0, unsigned int lane,
+                         const int match)
+{
+#if VECX_FINAL_LINEAR
+	const uint32_t *PS = &lv->PS_L[lane];
+#endif
+	uint8_t *bufout = lv->R[0].data;
+	uint64_t mask = 0;
+	vecx a[VECX_STREAM_COUNT];
+	vecx b[VECX_STREAM_COUNT];
+	vecx c[VECX_STREAM_COUNT];
+	vecx d[VECX_STREAM_COUNT];
+	vecx e[VECX_STREAM_COUNT];
+#if VECX_FINAL_RING
+	vecx W[16][VECX_STREAM_COUNT];
+#else
+	/* 80 rounds minus the 3 finals */
+	vecx W[77][VECX_STREAM_COUNT];
+#endif
+
+	/* All rounds are interleaved between streams (independent data) */
+	vecx_EACH(vecx_FINAL_LOAD, vexpo_0);
+
+	vecx_EACH(vecx_ROUND_E, vecx_F1,            4, b, c, d, e, a, VEC_SHA1_K1);
+	vecx_EACH(vecx_ROUND_E, vecx_F1,            5, a, b, c, d, e, VEC_SHA1_K1);
+	vecx_EACH(vecx_ROUND_E, vecx_F1,            6, e, a, b, c, d, VEC_SHA1_K1);
+	vecx_EACH(vecx_ROUND_E, vecx_F1,            7, d, e, a, b, c, VEC_SHA1_K1);
+	vecx_EACH(vecx_ROUND_E, vecx_F1,            8, c, d, e, a, b, VEC_SHA1_K1);
+	vecx_EACH(vecx_ROUND_E, vecx_F1,            9, b, c, d, e, a, VEC_SHA1_K1);
+	vecx_EACH(vecx_ROUND_E, vecx_F1,           10, a, b, c, d, e, VEC_SHA1_K1);
+	vecx_EACH(vecx_ROUND_E, vecx_F1,           11, e, a, b, c, d, VEC_SHA1_K1);
+	vecx_EACH(vecx_ROUND_E, vecx_F1,           12, d, e, a, b, c, VEC_SHA1_K1);
+	vecx_EACH(vecx_ROUND_E, vecx_F1,           13, c, d, e, a, b, VEC_SHA1_K1);
+	vecx_EACH(vecx_ROUND_E, vecx_F1,           14, b, c, d, e, a, VEC_SHA1_K1);
+	vecx_EACH(vecx_ROUND_F, vecx_F1, vecx_LDW, 15, a, b, c, d, e, VEC_SHA1_K1);
+
+	vecx_EACH(vecx_ROUND_O, vecx_F1, vecx_SCHED(vecx_MXC), 16, e, a, b, c, d, VEC_SHA1_K1);
+	vecx_EACH(vecx_ROUND_O, vecx_F1, vecx_SCHED(vecx_MXC), 17, d, e, a, b, c, VEC_SHA1_K1);
+	vecx_EACH(vecx_ROUND_O, vecx_F1, vecx_SCHED(vecx_MX9), 18, c, d, e, a, b, VEC_SHA1_K1);
+	vecx_EACH(vecx_ROUND_O, vecx_F1, vecx_SCHED(vecx_MX9), 19, b, c, d, e, a, VEC_SHA1_K1);
+
+	vecx_EACH(vecx_ROUND_O, vecx_F2, vecx_SCHED(vecx_MX1), 20, a, b, c, d, e, VEC_SHA1_K2);
+	vecx_EACH(vecx_ROUND_O, vecx_F2, vecx_SCHED(vecx_MX1), 21, e, a, b, c, d, VEC_SHA1_K2);
+	vecx_EACH(vecx_ROUND_O, vecx_F2, vecx_SCHED(vecx_MX1), 22, d, e, a, b, c, VEC_SHA1_K2);
+	vecx_EACH(vecx_ROUND_O, vecx_F2, vecx_SCHED(vecx_MX3), 23, c, d, e, a, b, VEC_SHA1_K2);
+	vecx_EACH(vecx_ROUND_O, vecx_F2, vecx_SCHED(vecx_MX3), 24, b, c, d, e, a, VEC_SHA1_K2);
+	vecx_EACH(vecx_ROUND_O, vecx_F2, vecx_SCHED(vecx_MX3), 25, a, b, c, d, e, VEC_SHA1_K2);
+	vecx_EACH(vecx_ROUND_O, vecx_F2, vecx_SCHED(vecx_MX3), 26, e, a, b, c, d, VEC_SHA1_K2);
+	vecx_EACH(vecx_ROUND_O, vecx_F2, vecx_SCHED(vecx_MX3), 27, d, e, a, b, c, VEC_SHA1_K2);
+	vecx_EACH(vecx_ROUND_O, vecx_F2, vecx_SCHED(vecx_MX3), 28, c, d, e, a, b, VEC_SHA1_K2);
+	vecx_EACH(vecx_ROUND_O, vecx_F2, vecx_SCHED(vecx_MX7), 29, b, c, d, e, a, VEC_SHA1_K2);
+	vecx_EACH(vecx_ROUND_O, vecx_F2, vecx_SCHED(vecx_MX7), 30, a, b, c, d, e, VEC_SHA1_K2);
+	vecx_EACH(vecx_ROUND_O, vecx_F2, vecx_SCHED(vecx_MXF), 31, e, a, b, c, d, VEC_SHA1_K2);
+	vecx_EACH(vecx_ROUND_O, vecx_F2, vecx_SCHED(vecx_MXF), 32, d, e, a, b, c, VEC_SHA1_K2);
+	vecx_EACH(vecx_ROUND_O, vecx_F2, vecx_SCHED(vecx_MXF), 33, c, d, e, a, b, VEC_SHA1_K2);
+	vecx_EACH(vecx_ROUND_O, vecx_F2, vecx_SCHED(vecx_MXF), 34, b, c, d, e, a, VEC_SHA1_K2);
+	vecx_EACH(vecx_ROUND_O, vecx_F2, vecx_SCHED(vecx_MXF), 35, a, b, c, d, e, VEC_SHA1_K2);
+	vecx_EACH(vecx_ROUND_O, vecx_F2, vecx_SCHED(vecx_MXF), 36, e, a, b, c, d, VEC_SHA1_K2);
+	vecx_EACH(vecx_ROUND_O, vecx_F2, vecx_SCHED(vecx_MXF), 37, d, e, a, b, c, VEC_SHA1_K2);
+	vecx_EACH(vecx_ROUND_O, vecx_F2, vecx_SCHED(vecx_MXF), 38, c, d, e, a, b, VEC_SHA1_K2);
+	vecx_EACH(vecx_ROUND_O, vecx_F2, vecx_SCHED(vecx_MXF), 39, b, c, d, e, a, VEC_SHA1_K2);
+
+	vecx_EACH(vecx_ROUND_O, vecx_F3, vecx_SCHED(vecx_MXF), 40, a, b, c, d, e, VEC_SHA1_K3);
+	vecx_EACH(vecx_ROUND_O, vecx_F3, vecx_SCHED(vecx_MXF), 41, e, a, b, c, d, VEC_SHA1_K3);
+	vecx_EACH(vecx_ROUND_O, vecx_F3, vecx_SCHED(vecx_MXF), 42, d, e, a, b, c, VEC_SHA1_K3);
+	vecx_EACH(vecx_ROUND_O, vecx_F3, vecx_SCHED(vecx_MXF), 43, c, d, e, a, b, VEC_SHA1_K3);
+	vecx_EACH(vecx_ROUND_O, vecx_F3, vecx_SCHED(vecx_MXF), 44, b, c, d, e, a, VEC_SHA1_K3);
+	vecx_EACH(vecx_ROUND_O, vecx_F3, vecx_SCHED(vecx_MXF), 45, a, b, c, d, e, VEC_SHA1_K3);
+	vecx_EACH(vecx_ROUND_O, vecx_F3, vecx_SCHED(vecx_MXF), 46, e, a, b, c, d, VEC_SHA1_K3);
+	vecx_EACH(vecx_ROUND_O, vecx_F3, vecx_SCHED(vecx_MXF), 47, d, e, a, b, c, VEC_SHA1_K3);
+	vecx_EACH(vecx_ROUND_O, vecx_F3, vecx_SCHED(vecx_MXF), 48, c, d, e, a, b, VEC_SHA1_K3);
+	vecx_EACH(vecx_ROUND_O, vecx_F3, vecx_SCHED(vecx_MXF), 49, b, c, d, e, a, VEC_SHA1_K3);
+	vecx_EACH(vecx_ROUND_O, vecx_F3, vecx_SCHED(vecx_MXF), 50, a, b, c, d, e, VEC_SHA1_K3);
+	vecx_EACH(vecx_ROUND_O, vecx_F3, vecx_SCHED(vecx_MXF), 51, e, a, b, c, d, VEC_SHA1_K3);
+	vecx_EACH(vecx_ROUND_O, vecx_F3, vecx_SCHED(vecx_MXF), 52, d, e, a, b, c, VEC_SHA1_K3);
+	vecx_EACH(vecx_ROUND_O, vecx_F3, vecx_SCHED(vecx_MXF), 53, c, d, e, a, b, VEC_SHA1_K3);
+	vecx_EACH(vecx_ROUND_O, vecx_F3, vecx_SCHED(vecx_MXF), 54, b, c, d, e, a, VEC_SHA1_K3);
+	vecx_EACH(vecx_ROUND_O, vecx_F3, vecx_SCHED(vecx_MXF), 55, a, b, c, d, e, VEC_SHA1_K3);
+	vecx_EACH(vecx_ROUND_O, vecx_F3, vecx_SCHED(vecx_MXF), 56, e, a, b, c, d, VEC_SHA1_K3);
+	vecx_EACH(vecx_ROUND_O, vecx_F3, vecx_SCHED(vecx_MXF), 57, d, e, a, b, c, VEC_SHA1_K3);
+	vecx_EACH(vecx_ROUND_O, vecx_F3, vecx_SCHED(vecx_MXF), 58, c, d, e, a, b, VEC_SHA1_K3);
+	vecx_EACH(vecx_ROUND_O, vecx_F3, vecx_SCHED(vecx_MXF), 59, b, c, d, e, a, VEC_SHA1_K3);
+
+	vecx_EACH(vecx_ROUND_O, vecx_F4, vecx_SCHED(vecx_MXF), 60, a, b, c, d, e, VEC_SHA1_K4);
+	vecx_EACH(vecx_ROUND_O, vecx_F4, vecx_SCHED(vecx_MXF), 61, e, a, b, c, d, VEC_SHA1_K4);
+	vecx_EACH(vecx_ROUND_O, vecx_F4, vecx_SCHED(vecx_MXF), 62, d, e, a, b, c, VEC_SHA1_K4);
+	vecx_EACH(vecx_ROUND_O, vecx_F4, vecx_SCHED(vecx_MXF), 63, c, d, e, a, b, VEC_SHA1_K4);
+	vecx_EACH(vecx_ROUND_O, vecx_F4, vecx_SCHED(vecx_MXF), 64, b, c, d, e, a, VEC_SHA1_K4);
+	vecx_EACH(vecx_ROUND_O, vecx_F4, vecx_SCHED(vecx_MXF), 65, a, b, c, d, e, VEC_SHA1_K4);
+	vecx_EACH(vecx_ROUND_O, vecx_F4, vecx_SCHED(vecx_MXF), 66, e, a, b, c, d, VEC_SHA1_K4);
+	vecx_EACH(vecx_ROUND_O, vecx_F4, vecx_SCHED(vecx_MXF), 67, d, e, a, b, c, VEC_SHA1_K4);
+	vecx_EACH(vecx_ROUND_O, vecx_F4, vecx_SCHED(vecx_MXF), 68, c, d, e, a, b, VEC_SHA1_K4);
+	vecx_EACH(vecx_ROUND_O, vecx_F4, vecx_SCHED(vecx_MXF), 69, b, c, d, e, a, VEC_SHA1_K4);
+	vecx_EACH(vecx_ROUND_O, vecx_F4, vecx_SCHED(vecx_MXF), 70, a, b, c, d, e, VEC_SHA1_K4);
+	vecx_EACH(vecx_ROUND_O, vecx_F4, vecx_SCHED(vecx_MXF), 71, e, a, b, c, d, VEC_SHA1_K4);
+	vecx_EACH(vecx_ROUND_O, vecx_F4, vecx_SCHED(vecx_MXF), 72, d, e, a, b, c, VEC_SHA1_K4);
+	vecx_EACH(vecx_ROUND_O, vecx_F4, vecx_SCHED(vecx_MXF), 73, c, d, e, a, b, VEC_SHA1_K4);
+	vecx_EACH(vecx_ROUND_O, vecx_F4, vecx_SCHED(vecx_MXF), 74, b, c, d, e, a, VEC_SHA1_K4);
+	vecx_EACH(vecx_ROUND_O, vecx_F4, vecx_SCHED(vecx_MXF), 75, a, b, c, d, e, VEC_SHA1_K4);
+	vecx_EACH(vecx_ROUND_O, vecx_F4, vecx_SCHED(vecx_MXF), 76, e, a, b, c, d, VEC_SHA1_K4);
+	vecx_EACH(vecx_ROUND_F, vecx_F4, vecx_SCHED(vecx_MXF), 77, d, e, a, b, c, VEC_SHA1_K4);
+	vecx_EACH(vecx_ROUND_F, vecx_F4, vecx_SCHED(vecx_MXF), 78, c, d, e, a, b, VEC_SHA1_K4);
+	vecx_EACH(vecx_ROUND_F, vecx_F4, vecx_SCHED(vecx_MXF), 79, b, c, d, e, a, VEC_SHA1_K4);
+
+	/* We keep the first 3 words (12B) as we only need 10B for this attack */
+	vecx_EACH(vecx_FINAL_PROBE, mask, match);
+
+	/* Addresses are only transposed when at least one lane needs a lookup */
+	if (unlikely(mask)) {
+		vecx_EACH(vecx_FINAL_STORE, bufout);
+	}
+
+	return mask;
+}
+
+#if VECX_FINAL_RING
+# undef vecx_WX
+# define vecx_WX(x, t)   W[(x)][(t)]
+#endif
+
+#undef vecx_SCHED
+#undef VECX_FINAL_NAME
+#undef VECX_FINAL_LINEAR
+#undef VECX_FINAL_RING
@@ -1,6 +1,8 @@
 #include <errno.h>
 #include <pthread.h>
+#include <sched.h>
 #include <stdbool.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -11,7 +13,11 @@ static int leek_impl_exhaust(struct leek_rsa_item *item, struct leek_worker *wk)
 {
 	int ret;
 
-	ret = leek.implementation->exhaust(item, wk);
+	ret = wk->impl->exhaust(item, wk);
+
+	/* Partial matches need the key of this item (see --best) */
+	if (wk->best_count)
+		leek_result_best_flush(item, wk);
 
 	/* Destroy the RSA item and recycle primes if relevant */
 	leek_item_destroy(item);
@@ -30,7 +36,7 @@ static void *leek_worker(void *arg)
 	wk->stats.ts_start = leek_timestamp();
 
 	while (1) {
-		item = leek_item_generate();
+		item = leek_item_generate(wk->impl);
 		if (!item)
 			goto out;
 
@@ -57,6 +63,145 @@ out:
 }
 
 
+/* Choose CPU and implementation for each worker (see --placement) */
+static void leek_workers_place(struct leek_worker *workers, unsigned int count)
+{
+	unsigned int policy = leek.options.placement;
+
+	for (unsigned int i = 0; i < count; ++i) {
+		workers[i].impl = leek.implementation;
+		workers[i].hashes = &leek.hashes;
+		workers[i].cpu = -1;
+	}
+
+	if (policy == LEEK_PLACEMENT_NONE || !leek.topology.cpus)
+		return;
+
+	/* Mixed placement needs SMT siblings next to each other */
+	leek_topology_sort(policy == LEEK_PLACEMENT_SPREAD);
+
+	for (unsigned int i = 0; i < count; ++i) {
+		const struct leek_topology_cpu *cpu;
+
+		cpu = &leek.topology.cpus[i % leek.topology.logical];
+		workers[i].cpu = cpu->id;
+		workers[i].node = cpu->node;
+
+		/* Other SMT threads run on different execution units */
+		if (policy == LEEK_PLACEMENT_MIXED && cpu->thread)
+			workers[i].impl = leek.sibling_implementation;
+	}
+}
+
+
+static void *leek_workers_replica(void *arg)
+{
+	struct leek_hashes **replica = arg;
+
+	*replica = leek_hashes_replicate();
+	return NULL;
+}
+
+
+/* Copy lookup structures on each NUMA node from a thread running there,
+ * so that memory is allocated locally (first touch policy). */
+static int leek_workers_replicate(struct leek_worker *workers, unsigned int count)
+{
+	unsigned int nodes = leek.topology.nodes;
+	struct leek_hashes **replicas;
+	int ret = -1;
+
+	if (!(leek.options.flags & LEEK_OPTION_NUMA) || !leek.topology.cpus || nodes < 2)
+		return 0;
+
+	replicas = calloc(nodes, sizeof(*replicas));
+	if (!replicas) {
+		fprintf(stderr, "error: calloc: %s\n", strerror(errno));
+		goto out;
+	}
+	leek.workers.replicas = replicas;
+	leek.workers.replica_count = nodes;
+
+	for (unsigned int n = 0; n < nodes; ++n) {
+		pthread_attr_t attr;
+		pthread_t thread;
+		cpu_set_t cpuset;
+
+		CPU_ZERO(&cpuset);
+		for (unsigned int i = 0; i < leek.topology.logical; ++i) {
+			if (leek.topology.cpus[i].node == n)
+				CPU_SET(leek.topology.cpus[i].id, &cpuset);
+		}
+
+		/* Nodes without CPUs are memory only (or fake, see --numa) */
+		if (!CPU_COUNT(&cpuset) && !leek.options.numa_nodes)
+			continue;
+
+		ret = pthread_attr_init(&attr);
+		if (!ret) {
+			if (CPU_COUNT(&cpuset))
+				ret = pthread_attr_setaffinity_np(&attr, sizeof(cpuset), &cpuset);
+			if (!ret)
+				ret = pthread_create(&thread, &attr, leek_workers_replica, &replicas[n]);
+			if (!ret)
+				pthread_join(thread, NULL);
+			pthread_attr_destroy(&attr);
+		}
+		if (ret) {
+			fprintf(stderr, "error: pthread_create: %s\n", strerror(ret));
+			ret = -1;
+			goto out;
+		}
+		if (!replicas[n]) {
+			fprintf(stderr, "error: unable to copy lookup structures on node %u.\n", n);
+			ret = -1;
+			goto out;
+		}
+	}
+
+	for (unsigned int i = 0; i < count; ++i) {
+		if (workers[i].cpu >= 0 && replicas[workers[i].node])
+			workers[i].hashes = replicas[workers[i].node];
+	}
+
+	if (leek.options.flags & LEEK_OPTION_VERBOSE)
+		printf("[+] Copied lookup structures on %u NUMA nodes.\n", nodes);
+
+	ret = 0;
+out:
+	return ret;
+}
+
+
+static int leek_worker_create(struct leek_worker *wk)
+{
+	pthread_attr_t attr;
+	int ret;
+
+	ret = pthread_attr_init(&attr);
+	if (ret)
+		goto out;
+
+	if (wk->cpu >= 0) {
+		cpu_set_t cpuset;
+
+		CPU_ZERO(&cpuset);
+		CPU_SET(wk->cpu, &cpuset);
+
+		ret = pthread_attr_setaffinity_np(&attr, sizeof(cpuset), &cpuset);
+		if (ret)
+			goto attr_destroy;
+	}
+
+	ret = pthread_create(&wk->thread, &attr, leek_worker, wk);
+
+attr_destroy:
+	pthread_attr_destroy(&attr);
+out:
+	return ret;
+}
+
+
 int leek_workers_start(void)
 {
 	struct leek_worker *workers;
@@ -68,10 +213,28 @@ int leek_workers_start(void)
 	leek.workers.worker = workers;
 	leek.workers.count = leek.options.threads;
 
+	leek_workers_place(workers, leek.workers.count);
+
+	if (leek.options.flags & LEEK_OPTION_BEST) {
+		for (unsigned int i = 0; i < leek.workers.count; ++i) {
+			workers[i].best = calloc(leek.options.best_count, sizeof(*workers[i].best));
+			if (!workers[i].best) {
+				fprintf(stderr, "error: calloc: %s\n", strerror(errno));
+				ret = -1;
+				goto out;
+			}
+		}
+	}
+
+	ret = leek_workers_replicate(workers, leek.workers.count);
+	if (ret < 0)
+		goto out;
+
 	for (unsigned int i = 0; i < leek.workers.count; ++i) {
-		ret = pthread_create(&workers[i].thread, NULL, leek_worker, &workers[i]);
-		if (ret < 0) {
-			fprintf(stderr, "error: pthread_create: %s\n", strerror(errno));
+		ret = leek_worker_create(&workers[i]);
+		if (ret) {
+			fprintf(stderr, "error: pthread_create: %s\n", strerror(ret));
+			ret = -1;
 			goto out;
 		}
 		/* This thread is now active! */
@@ -110,8 +273,16 @@ void leek_workers_stop(void)
 		/* Show all gathered statistics before quitting for real */
 		leek_stats_perf_display(verbose);
 
+		for (unsigned int i = 0; i < leek.workers.count; ++i)
+			free(leek.workers.worker[i].best);
 		free(leek.workers.worker);
 	}
 
+	for (unsigned int n = 0; n < leek.workers.replica_count; ++n)
+		leek_hashes_replica_free(leek.workers.replicas[n]);
+	free(leek.workers.replicas);
+	leek.workers.replicas = NULL;
+	leek.workers.replica_count = 0;
+
 	leek.workers.count = 0;
 }
@@ -3,12 +3,29 @@
 # include <pthread.h>
 # include <stdint.h>
 
+struct leek_best;
+struct leek_hashes;
+struct leek_implementation;
 
 /* Holds worker related information */
 struct leek_worker {
 	pthread_t thread;       /* Thread structure */
 	unsigned int flags;     /* Worker specific flags */
 
+	/* Implementation used by this worker (see leek_workers_place) */
+	const struct leek_implementation *impl;
+	int cpu;                /* Pinned logical CPU (-1 when not pinned) */
+	unsigned int node;      /* NUMA node of this CPU */
+
+	/* Lookup structures (a copy on the worker node with --numa) */
+	const struct leek_hashes *hashes;
+
+	/* Best partial matches of the current item (see --best), as a min-heap
+	 * on lengths only used by this worker until merged on the leaderboard */
+	struct leek_best *best;
+	unsigned int best_count;
+	unsigned int best_floor;  /* Length to beat to get in */
+
 	/* Worker specific statistics */
 	struct {
 		uint64_t ts_start;    /* Time of thread start */
@@ -28,6 +45,10 @@ enum {
 struct leek_workers {
 	struct leek_worker *worker; /* Worker structure */
 	unsigned int count;         /* Number of active workers */
+
+	/* Lookup structures copies (one per NUMA node, see --numa) */
+	struct leek_hashes **replicas;
+	unsigned int replica_count;
 };
 
 